@@ -23,6 +23,12 @@
 #include "include/jet_factory.h"
 #include "include/met_factory.h"
 #include "include/SF_factory.h"
+#include "include/sample_table.h"
+#include "include/lazy_histos.h"
+#include "include/weight_table.h"
+#include "include/weight_variations.h"
+#include "include/bootstrap.h"
+#include "include/fast_hist.h"
 #include "include/util.h"
 #include "include/btagSF.h"
 #include "include/LumiReweightingStandAlone.h"
@@ -77,7 +83,7 @@ int main(int argc, char* argv[]) {
   if (isData)
     norm = 1.0;
   else
-    norm = luminosity * cross_sections[sample] / gen_number;
+    norm = luminosity * sample_table::get().getCrossSection(sample) / gen_number;
 
   ///////////////////////////////////////////////
   // Scale Factors:                            //
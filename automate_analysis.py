@@ -5,9 +5,11 @@
 ## a directory.                                           ##
 ############################################################
 
-from os import popen
+from os import popen, path, walk, rename
 from subprocess import call
 from optparse import OptionParser
+import hashlib
+import json
 import time
 from glob import glob
 
@@ -36,63 +38,184 @@ parser.add_option('--prefix', '-P', action='store',
                   default=None, dest='prefix',
                   help='prefix to strip'
 )
+parser.add_option('--manifest', '-m', action='store',
+                  default='output/manifest.json', dest='manifest',
+                  help='file recording the inputs used for each output'
+                  )
+parser.add_option('--force', '-f', action='store_true',
+                  default=False, dest='force',
+                  help='rerun all jobs even if they are up to date'
+                  )
+parser.add_option('--checksum', action='store_true',
+                  default=False, dest='checksum',
+                  help='compare input files by checksum instead of size and mtime'
+                  )
+parser.add_option('--dry-run', '-n', action='store_true',
+                  default=False, dest='dry_run',
+                  help='only print which jobs would run'
+                  )
+parser.add_option('--samples', action='store',
+                  default='inputs/samples.txt', dest='samples',
+                  help='sample table with the data/MC flag and processes of each sample'
+                  )
 (options, args) = parser.parse_args()
 suffix = options.suffix
 prefix = options.prefix
 
+def md5sum(fname):
+    md5 = hashlib.md5()
+    with open(fname, 'rb') as ifile:
+        for chunk in iter(lambda: ifile.read(1 << 20), b''):
+            md5.update(chunk)
+    return md5.hexdigest()
+
+def inputID(fname):
+    if options.checksum:
+        return md5sum(fname)
+    return '%d:%d' % (path.getsize(fname), path.getmtime(fname))
+
+def correctionsID():
+    md5 = hashlib.md5()
+    for directory in ['inputs', 'LeptonEfficiencies']:
+        for root, dirs, files in sorted(walk(directory)):
+            for ifile in sorted(files):
+                md5.update((path.join(root, ifile)+md5sum(path.join(root, ifile))).encode())
+    return md5.hexdigest()
+
+def outputName(sample, name, syst):
+    # must match the output naming in the analyzers
+    systname = '_'+syst if syst else ''
+    if name == sample:
+        return 'output/'+name+systname+'_output.root'
+    return 'output/'+sample+'_'+name+systname+'_output.root'
+
+def outputID(fname):
+    # moving the output (hadder) keeps its size and mtime
+    return '%d:%d' % (path.getsize(fname), path.getmtime(fname))
+
+def findOutput(output):
+    # hadder moves the outputs to output/originals after merging them
+    for fname in [output, path.join(path.dirname(output), 'originals', path.basename(output))]:
+        if path.exists(fname):
+            return fname
+    return None
+
+def whyRun(job, manifest):
+    if options.force:
+        return 'forced'
+    found = findOutput(job['output'])
+    if not found:
+        return 'no output'
+    if not job['output'] in manifest:
+        return 'not in manifest'
+    old = manifest[job['output']]
+    for dep in ['input', 'exe', 'corrections', 'options']:
+        if old.get(dep) != job['fingerprint'][dep]:
+            return dep+' changed'
+    if old.get('output') != outputID(found):
+        return 'output changed'
+    return None
+
+def saveManifest():
+    with open(options.manifest, 'w') as ofile:
+        json.dump(manifest, ofile, indent=2, sort_keys=True)
+
+def readSamples(fname):
+    # same format as include/sample_table.h reads
+    samples = {}
+    with open(fname) as ifile:
+        for line in ifile:
+            fields = line.split('#')[0].split()
+            if not fields:
+                continue
+            samples[fields[0]] = {
+                'data': fields[1] == 'data',
+                'processes': fields[5].split(','),
+            }
+    return samples
+
+samples = readSamples(options.samples)
+
+manifest = {}
+if path.exists(options.manifest):
+    with open(options.manifest) as ifile:
+        manifest = json.load(ifile)
+
 start = time.time()
-if options.isData:
-    fileList = [ifile for ifile in glob(options.path+'/*') if '.root' in ifile and 'data' in ifile.lower()]
-else:
-    fileList = [ifile for ifile in glob(options.path+'/*') if '.root' in ifile and not 'data' in ifile.lower()]
+fileList = [ifile for ifile in glob(options.path+'/*') if '.root' in ifile]
 
 systs = ['', 'met_UESUp', 'met_UESDown', 'met_JESUp', 'met_JESDown', 'metphi_UESUp', 'metphi_UESDown', 'metphi_JESUp', 'metphi_JESDown', 'mjj_JESUp', 'mjj_JESDown']
 
+exeID = md5sum(options.exe)
+corrID = correctionsID()
+
+jobs = []
+selected = []
+unknown = []
 for ifile in fileList:
     sample = ifile.split('/')[-1].split(suffix)[0]
     if prefix:
       sample = sample.replace(prefix, '')
     tosample = ifile.replace(sample+suffix,'')
-    print sample
-
-    if 'DYJets' in ifile:
-        names = ['ZTT', 'ZL', 'ZJ']
-    elif 'TT' in ifile:
-        names = ['TTT', 'TTJ']
-    elif 'WJets' in ifile or 'EWKW' in ifile:
-        names = ['W']
-    elif 'EWKZ' in ifile:
-        names = ['EWKZ']
-    elif 'data' in ifile.lower():
-        names = ['data_obs']
-    elif 'ggHtoTauTau' in ifile:
-        mass = sample.split('ggHtoTauTau')[-1]
-        names = ['ggH'+mass]
-    elif 'VBFHtoTauTau' in ifile:
-        mass = sample.split('VBFHtoTauTau')[-1]
-        names = ['VBF'+mass]
-    elif 'WPlusH' in ifile or 'WMinusH' in ifile:
-        mass = sample.split('HTauTau')[-1]
-        names = ['WH'+mass]
-    elif 'ZH' in ifile:
-        mass = sample.split('ZHTauTau')[-1]
-        names = ['ZH'+mass]
-    else: 
-        names = ['VV']
+
+    # processes come from the sample table, files not in it are never run
+    if not sample in samples:
+        unknown.append(ifile)
+        continue
+    if samples[sample]['data'] != options.isData:
+        continue
+    selected.append(ifile)
+    names = samples[sample]['processes']
 
     callstring = './%s -p %s -s %s -P %s' % (options.exe, tosample, sample, suffix)
 
-    if options.syst:
-        for isyst in systs:
-            for name in names:
-                tocall = callstring + ' -n %s -u %s' % (name, isyst)
-                call(tocall, shell=True)
-    else:
+    fileID = inputID(ifile)
+    for isyst in (systs if options.syst else ['']):
         for name in names:
-            tocall = callstring + ' -n %s' % name 
-            call(tocall, shell=True)
+            if options.syst:
+                tocall = callstring + ' -n %s -u %s' % (name, isyst)
+            else:
+                tocall = callstring + ' -n %s' % name
+            jobs.append({
+                'call': tocall,
+                'input': ifile,
+                'output': outputName(sample, name, isyst),
+                'fingerprint': {'input': fileID, 'exe': exeID, 'corrections': corrID, 'options': tocall},
+            })
+
+# print the plan grouped by input file before running anything
+print 'Plan:'
+for ifile in selected:
+    print ' ', ifile
+    for job in [job for job in jobs if job['input'] == ifile]:
+        reason = whyRun(job, manifest)
+        job['run'] = reason != None
+        print '    %-4s %s (%s)' % ('RUN' if job['run'] else 'SKIP', job['output'], reason if reason else 'up to date')
+for ifile in unknown:
+    print ' ', ifile
+    print '    SKIP (not in %s)' % options.samples
+torun = [job for job in jobs if job['run']]
+print '%d of %d jobs to run' % (len(torun), len(jobs))
+
+if not options.dry_run:
+    # up-to-date outputs go back next to the new ones, so the merge in hadder sees all of them
+    for job in [job for job in jobs if not job['run']]:
+        found = findOutput(job['output'])
+        if found != job['output']:
+            rename(found, job['output'])
 
-    print tocall
+    for job in torun:
+        # forget the old output first, a job that crashes may leave a partial one
+        if job['output'] in manifest:
+            del manifest[job['output']]
+            saveManifest()
+        print job['call']
+        if call(job['call'], shell=True) == 0 and path.exists(job['output']):
+            # record each finished job right away so an interruption keeps them
+            manifest[job['output']] = dict(job['fingerprint'], output=outputID(job['output']))
+            saveManifest()
+        else:
+            print 'Job failed:', job['call']
 
 end = time.time()
 print 'Processing completed in', end-start, 'seconds.'
@@ -0,0 +1,152 @@
+// system includes
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ROOT includes
+#include "TH1D.h"
+#include "TTree.h"
+#include "TFile.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+
+// user includes
+#include "include/CLParser.h"
+#include "include/tree_io.h"
+#include "include/skim_cache.h"
+#include "include/column_file.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To convert an analysis tree (etau_tree,     //
+// mutau_tree, tt_tree) into an uncompressed column     //
+// file that the analyzers read with --columns.         //
+//   -s, -p, -P : input file, same as the analyzers     //
+//   -t TREE    : tree to convert                       //
+//   -o FILE    : output (columns/<sample>.cols)        //
+// Every branch holding a fixed-size leaf is converted. //
+//////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+  CLParser parser(argc, argv);
+  std::string sample = parser.Option("-s");
+  std::string path = parser.Option("-p");
+  std::string postfix = parser.Option("-P");
+  std::string tree_name = parser.Option("-t");
+  std::string output = parser.Option("-o");
+  std::string fname = path + sample + postfix;
+  if (output.empty()) {
+    output = "columns/" + sample + ".cols";
+  }
+
+  auto fin = TFile::Open(fname.c_str());
+  if (!fin || fin->IsZombie()) {
+    std::cerr << "Unable to open " << fname << std::endl;
+    return 1;
+  }
+  auto ntuple = (TTree*)fin->Get(tree_name.c_str());
+  if (!ntuple) {
+    std::cerr << "No tree " << tree_name << " in " << fname << std::endl;
+    return 1;
+  }
+  auto counts = (TH1D*)fin->Get("nevents");
+  Long64_t nentries = ntuple->GetEntries();
+
+  // one column per branch with a single fixed-size leaf
+  std::vector<column_info> infos;
+  std::vector<TBranch*> branches;
+  auto all_branches = ntuple->GetListOfBranches();
+  for (int i = 0; i < all_branches->GetEntriesFast(); i++) {
+    auto branch = (TBranch*)all_branches->At(i);
+    auto leaves = branch->GetListOfLeaves();
+    auto leaf = (TLeaf*)leaves->At(0);
+    if (leaves->GetEntriesFast() != 1 || leaf->GetLeafCount() != nullptr ||
+        std::strlen(branch->GetName()) >= sizeof(column_info::name)) {
+      std::cout << "Skipping branch " << branch->GetName() << std::endl;
+      continue;
+    }
+    column_info info;
+    std::memset(&info, 0, sizeof(info));
+    std::strncpy(info.name, branch->GetName(), sizeof(info.name) - 1);
+    std::strncpy(info.type, leaf->GetTypeName(), sizeof(info.type) - 1);
+    info.size = leaf->GetLenType() * leaf->GetLen();
+    infos.push_back(info);
+    branches.push_back(branch);
+  }
+
+  // arrays start on 64-byte boundaries after the header and column table
+  Long64_t offset = sizeof(column_header) + infos.size() * sizeof(column_info);
+  for (auto& info : infos) {
+    offset = (offset + 63) / 64 * 64;
+    info.offset = offset;
+    offset += info.size * nentries;
+  }
+  Long64_t total_size = offset;
+
+  // write through a mapping of a temporary file, then move it in place
+  mkdir("columns", 0755);
+  std::string tmp_name = output + ".tmp";
+  int fd = open(tmp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, total_size) != 0) {
+    std::cerr << "Unable to create " << tmp_name << std::endl;
+    return 1;
+  }
+  void *addr = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "Unable to map " << tmp_name << std::endl;
+    return 1;
+  }
+  char *mapping = static_cast<char*>(addr);
+
+  column_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, column_magic, sizeof(column_magic));
+  std::strncpy(header.input, skim_cache::fileID(fin).c_str(), sizeof(header.input) - 1);
+  header.nevents = counts ? counts->GetBinContent(2) : 0.;
+  header.entries = nentries;
+  header.ncolumns = infos.size();
+  std::memcpy(mapping, &header, sizeof(header));
+  std::memcpy(mapping + sizeof(header), infos.data(), infos.size() * sizeof(column_info));
+
+  // read every entry once into a staging row and scatter it into the columns
+  std::vector<Long64_t> row_offsets;
+  Long64_t row_size(0);
+  for (auto& info : infos) {
+    row_offsets.push_back(row_size);
+    row_size += info.size;
+  }
+  std::vector<char> staging(row_size);
+  ntuple->SetBranchStatus("*", 0);
+  for (unsigned i = 0; i < branches.size(); i++) {
+    ntuple->SetBranchStatus(branches.at(i)->GetName(), 1);
+    ntuple->SetBranchAddress(branches.at(i)->GetName(), (void*)&staging[row_offsets.at(i)]);
+  }
+  ntuple->SetCacheSize(30 * 1024 * 1024);
+  ntuple->AddBranchToCache("*", true);
+
+  for (Long64_t entry = 0; entry < nentries; entry++) {
+    if (entry % 100000 == 0)
+      std::cout << "Converting event: " << entry << " out of " << nentries << std::endl;
+    ntuple->GetEntry(entry);
+    for (unsigned i = 0; i < infos.size(); i++) {
+      std::memcpy(mapping + infos.at(i).offset + entry * infos.at(i).size, &staging[row_offsets.at(i)], infos.at(i).size);
+    }
+  }
+
+  msync(mapping, total_size, MS_SYNC);
+  munmap(mapping, total_size);
+  fin->Close();
+
+  if (std::rename(tmp_name.c_str(), output.c_str()) != 0) {
+    std::cerr << "Unable to write " << output << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << infos.size() << " columns of " << nentries << " entries (" << total_size / (1024 * 1024) << " MB) to " << output << std::endl;
+  return 0;
+}
@@ -0,0 +1,106 @@
+// system includes
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// ROOT includes
+#include "TH1F.h"
+
+// user includes
+#include "include/CLParser.h"
+#include "include/fast_hist.h"
+#include "include/shared_hist.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To measure the fill rate of the shared_hist //
+// modes for different histogram sizes and numbers of   //
+// threads, and show which mode auto picks. Every       //
+// thread fills uniformly distributed values, which is  //
+// the worst case for contention on small histograms.   //
+//   -j N          : largest number of threads (all     //
+//                   cores by default), doubled from 1  //
+//   --fills N     : fills per thread (default 10^7)    //
+//   --bins a,b,.. : histogram sizes (default 12, 100,  //
+//                   10000, 1000000)                    //
+//////////////////////////////////////////////////////////
+
+// fill rate in millions of fills per second, all threads together
+double run(shared_hist& hist, unsigned nthreads, Long64_t nfills) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned slot = 0; slot < nthreads; slot++) {
+    workers.emplace_back([&hist, slot, nfills]() {
+      // xorshift, cheap enough not to hide the cost of the fill
+      ULong64_t state = 0x9e3779b97f4a7c15ULL * (slot + 1);
+      for (Long64_t i = 0; i < nfills; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        hist.fill(slot, (state >> 11) * (1. / 9007199254740992.), 0., 1.);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return nthreads * nfills / elapsed.count() / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+  CLParser parser(argc, argv);
+  std::string threads = parser.Option("-j");
+  std::string fills = parser.Option("--fills");
+  std::string bins = parser.Option("--bins");
+  unsigned max_threads = threads.empty() ? std::max(1u, std::thread::hardware_concurrency()) : std::stoi(threads);
+  Long64_t nfills = fills.empty() ? 10000000 : std::stoll(fills);
+
+  std::vector<int> sizes = {12, 100, 10000, 1000000};
+  if (!bins.empty()) {
+    sizes.clear();
+    std::stringstream ss(bins);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      sizes.push_back(std::stoi(item));
+    }
+  }
+
+  TH1::AddDirectory(false);
+  std::cout << std::setw(10) << "bins" << std::setw(9) << "threads"
+            << std::setw(12) << "atomic" << std::setw(12) << "local" << std::setw(12) << "auto"
+            << "   (Mfills/s)   auto picked" << std::endl;
+  for (auto nbins : sizes) {
+    for (unsigned nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+      std::vector<double> rates;
+      std::string picked;
+      for (auto mode : {shared_hist::atomic, shared_hist::local, shared_hist::automatic}) {
+        TH1F target("benchmark", "", nbins, 0., 1.);
+        shared_hist hist(&target, nthreads, mode);
+        rates.push_back(run(hist, nthreads, nfills));
+        if (mode == shared_hist::automatic) {
+          std::stringstream ss;
+          ss << (hist.getMode() == shared_hist::atomic ? "atomic" : hist.getMode() == shared_hist::local ? "local" : "atomic, ")
+             << (hist.getMode() == shared_hist::automatic ? std::to_string(hist.getNLocal()) + " slots went local" : "")
+             << ", " << hist.getBytes() / 1024 << " kB";
+          picked = ss.str();
+        }
+
+        // every fill has weight 1 and lands inside the range
+        hist.flush();
+        if (target.Integral() != static_cast<double>(nthreads * nfills)) {
+          std::cerr << "Lost fills with " << nbins << " bins and " << nthreads << " threads" << std::endl;
+          return 1;
+        }
+      }
+      std::cout << std::setw(10) << nbins << std::setw(9) << nthreads << std::fixed << std::setprecision(1)
+                << std::setw(12) << rates.at(0) << std::setw(12) << rates.at(1) << std::setw(12) << rates.at(2)
+                << "                  " << picked << std::endl;
+    }
+  }
+  return 0;
+}
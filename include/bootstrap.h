@@ -0,0 +1,147 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include "TH2F.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To fill bootstrap replicas of the           //
+// signal-region (_OS) 2D templates in the same pass as //
+// the nominal. Every event gets one Poisson(1) count   //
+// per replica, drawn from a counter-based generator    //
+// keyed by (run, lumi, evt, replica), so the counts do //
+// not depend on the order, sharding or threading of    //
+// the job and an event has the same counts in every    //
+// job that sees it. Helper::fill2D adds count * weight //
+// to the bin of the nominal fill. All replicas of a    //
+// template are written as one TH2F <name>_bootstrap,   //
+// with the global bin of the nominal on x and the      //
+// replica on y.                                        //
+//   --bootstrap N : fill N replicas                    //
+//////////////////////////////////////////////////////////
+class bootstrap {
+private:
+  static const int max_count = 16;
+
+  int nreplicas;
+  bool drawn;
+  ULong64_t key;
+  std::vector<double> cdf;                                  // Poisson(1) cumulative probabilities
+  std::vector<UChar_t> counts;                              // of the current event
+  std::unordered_map<TH2F*, std::vector<double>> histos;    // ncells * nreplicas, bin-major, empty if not a replicated template
+
+  static ULong64_t mix(ULong64_t);
+  void draw();
+
+public:
+  bootstrap (int);
+  virtual ~bootstrap () {};
+
+  // getters
+  bool isEnabled()      { return nreplicas > 0; };
+  int getN()            { return nreplicas;     };
+
+  void start(UInt_t, UInt_t, ULong64_t);
+  void fill(std::string, TH2F*, Int_t, double);
+  void write(lazy_histos_2d*);
+};
+
+bootstrap::bootstrap(int n) :
+  nreplicas(std::max(n, 0)),
+  drawn(false),
+  key(0),
+  counts(nreplicas, 1)
+{
+  double term(std::exp(-1.)), sum(0.);
+  for (int k = 0; k < max_count; k++) {
+    sum += term;
+    cdf.push_back(sum);
+    term /= k + 1;
+  }
+}
+
+// splitmix64 finalizer, a bijection with good avalanche
+ULong64_t bootstrap::mix(ULong64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// new event, the counts are only drawn if it is filled
+void bootstrap::start(UInt_t run, UInt_t lumi, ULong64_t evt) {
+  key = mix(mix(mix(run) ^ lumi) ^ evt);
+  drawn = false;
+}
+
+// count of replica i from the uniform number of (key, i) through the inverse CDF
+void bootstrap::draw() {
+  for (int i = 0; i < nreplicas; i++) {
+    double u = (mix(key ^ mix(i)) >> 11) * (1. / 9007199254740992.);
+    int k(0);
+    while (k < max_count - 1 && u >= cdf[k]) {
+      k++;
+    }
+    counts[i] = k;
+  }
+  drawn = true;
+}
+
+void bootstrap::fill(std::string name, TH2F* hist, Int_t bin, double weight) {
+  if (nreplicas == 0) {
+    return;
+  }
+  auto found = histos.find(hist);
+  if (found == histos.end()) {
+    bool replicated = name.size() >= 3 && name.compare(name.size() - 3, 3, "_OS") == 0;
+    size_t size = replicated ? static_cast<size_t>(hist->GetNcells()) * nreplicas : 0;
+    found = histos.insert({hist, std::vector<double>(size, 0.)}).first;
+  }
+  if (found->second.empty()) {
+    return;
+  }
+
+  if (!drawn) {
+    draw();
+  }
+  double *contents = &found->second[static_cast<size_t>(bin) * nreplicas];
+  for (int i = 0; i < nreplicas; i++) {
+    contents[i] += counts[i] * weight;
+  }
+}
+
+// one histogram per replicated template, in the directory of the nominal
+void bootstrap::write(lazy_histos_2d* templates) {
+  if (nreplicas == 0) {
+    return;
+  }
+  auto dir = gDirectory;
+  int nwritten(0);
+  for (auto& entry : *templates) {
+    auto name = entry.first;
+    if (name.size() < 3 || name.compare(name.size() - 3, 3, "_OS") != 0) {
+      continue;
+    }
+    auto nominal = entry.second;
+    int ncells = nominal->GetNcells();
+    nominal->GetDirectory()->cd();
+    auto replicas = new TH2F((std::string(nominal->GetName()) + "_bootstrap").c_str(), ";global bin;replica",
+                             ncells, -0.5, ncells - 0.5, nreplicas, -0.5, nreplicas - 0.5);
+    nwritten++;
+    auto found = histos.find(nominal);
+    if (found == histos.end() || found->second.empty()) {
+      continue;
+    }
+    for (int bin = 0; bin < ncells; bin++) {
+      for (int i = 0; i < nreplicas; i++) {
+        replicas->SetBinContent(bin + 1, i + 1, found->second[static_cast<size_t>(bin) * nreplicas + i]);
+      }
+    }
+    replicas->ResetStats();
+    replicas->SetEntries(nominal->GetEntries());
+  }
+  dir->cd();
+  std::cout << "Filled " << nreplicas << " bootstrap replicas of " << nwritten << " templates" << std::endl;
+}
@@ -0,0 +1,206 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+//////////////////////////////////////////////////////////
+// Purpose: To compute b-tagging event weights for any  //
+// number of jets and tags. GetSF of btagSF.h is        //
+// sampled once per flavour (b/c and light) and shift   //
+// (nominal, up, down) on a uniform pT grid, so a jet   //
+// costs a table lookup instead of a rational function  //
+// and a chain of pT-bin branches. The grid has the     //
+// uncertainty bin edges of GetSF on its points, and    //
+// every cell is interpolated between the two ends of   //
+// its own branch, so the steps of the b/c uncertainty  //
+// are kept. The probability of k tags among n jets is  //
+// the k-th coefficient of prod_i (1 - SF_i + SF_i z),  //
+// built one jet at a time, for the three shifts at     //
+// once, in arrays on the stack (on the heap for more   //
+// than max_jets jets). Jets above the end of the grid  //
+// take its last value. A grid step that does not       //
+// divide the uncertainty bin edges is refused. With    //
+// check(), weight() is compared to a sum over every    //
+// tag assignment with GetSF itself.                    //
+//   --btag-check : print the largest difference        //
+//                  between weight() and the brute      //
+//                  force sum                           //
+//////////////////////////////////////////////////////////
+
+// event weight with the SFs shifted down and up by their uncertainty
+struct btag_event_weight {
+  double nominal, up, down;
+};
+
+class btag_weights {
+public:
+  enum shift { nominal, up, down, n_shifts };
+  enum flavour { bc, light, n_flavours };
+  static const int max_jets = 16;
+
+private:
+  bool valid;
+  int wp;
+  double step, inverse_step, max_pt;
+  int ncells;
+  std::vector<double> low, slope;     // [flavour][shift][cell]
+
+  static int getSyst(int s)           { return s == up ? 1 : s == down ? -1 : 0; };
+  static int getFlavour(int f)        { return std::abs(f) == 4 || std::abs(f) == 5 ? bc : light; };
+
+  void fillCoefficients(const double*, const int*, int, double*) const;
+
+public:
+  btag_weights (int, double, double);
+  virtual ~btag_weights () {};
+
+  // getters
+  bool isValid()        { return valid; };
+
+  double getSF(int flavour, double pt, int s) const {
+    pt = pt < 0. ? 0. : pt > max_pt ? max_pt : pt;
+    double position = pt * inverse_step;
+    int cell = int(position);
+    cell = cell < ncells ? cell : ncells - 1;
+    size_t i = (static_cast<size_t>(getFlavour(flavour)) * n_shifts + s) * ncells + cell;
+    return low[i] + (position - cell) * slope[i];
+  }
+
+  btag_event_weight weight(const double*, const int*, int, int) const;
+  btag_event_weight weight(std::vector<jet>&, int, int) const;
+
+  double check(int) const;
+};
+
+// the grid step must divide the uncertainty bin edges of GetSF (30, 50, 70, 100, 140, 200, 300, 600 GeV)
+btag_weights::btag_weights(int working_point, double grid_step, double highest_pt) :
+  valid(false),
+  wp(working_point),
+  step(grid_step),
+  inverse_step(1. / grid_step),
+  max_pt(highest_pt),
+  ncells(0)
+{
+  double edges[] = {30., 50., 70., 100., 140., 200., 300., 600.};
+  bool divides = grid_step > 0.;
+  for (auto edge : edges) {
+    divides = divides && std::fabs(edge / grid_step - std::round(edge / grid_step)) < 1e-9 * edge / grid_step;
+  }
+  if (!divides) {
+    std::cerr << "The b-tag grid step " << grid_step << " GeV must divide 30, 50, 70, 100, 140, 200, 300 and 600 GeV" << std::endl;
+    return;
+  }
+  ncells = int(std::ceil(highest_pt / grid_step));
+  low.resize(n_flavours * n_shifts * ncells);
+  slope.resize(n_flavours * n_shifts * ncells);
+
+  // a flavour GetSF puts in each class
+  int flavours[n_flavours] = {5, 0};
+  for (int f = 0; f < n_flavours; f++) {
+    for (int s = 0; s < n_shifts; s++) {
+      for (int cell = 0; cell < ncells; cell++) {
+        // the upper end just below the next grid point, still on this cell's
+        // branch once GetSF has rounded it to a float
+        double start = GetSF(wp, cell * step, flavours[f], getSyst(s));
+        double end = GetSF(wp, (cell + 1 - 1e-3) * step, flavours[f], getSyst(s));
+        size_t i = (static_cast<size_t>(f) * n_shifts + s) * ncells + cell;
+        low[i] = start;
+        slope[i] = (end - start) / (1 - 1e-3);
+      }
+    }
+  }
+  valid = true;
+}
+
+// coefficients[s * (njets + 1) + k]: probability of k tags with the SFs of shift s
+void btag_weights::fillCoefficients(const double* pt, const int* flavour, int njets, double* coefficients) const {
+  for (int s = 0; s < n_shifts; s++) {
+    double *c = coefficients + s * (njets + 1);
+    c[0] = 1.;
+    for (int k = 1; k <= njets; k++) {
+      c[k] = 0.;
+    }
+    for (int j = 0; j < njets; j++) {
+      double sf = getSF(flavour[j], pt[j], s);
+      for (int k = j + 1; k > 0; k--) {
+        c[k] = c[k] * (1 - sf) + c[k - 1] * sf;
+      }
+      c[0] *= 1 - sf;
+    }
+  }
+}
+
+// probability of ntags of the first njets jets being tagged
+btag_event_weight btag_weights::weight(const double* pt, const int* flavour, int njets, int ntags) const {
+  if (ntags < 0 || ntags > njets) {
+    return {0., 0., 0.};
+  }
+  double fixed[n_shifts * (max_jets + 1)];
+  std::vector<double> large;
+  if (njets > max_jets) {
+    large.resize(n_shifts * (njets + 1));
+  }
+  double *coefficients = njets > max_jets ? large.data() : fixed;
+  fillCoefficients(pt, flavour, njets, coefficients);
+  return {coefficients[nominal * (njets + 1) + ntags], coefficients[up * (njets + 1) + ntags], coefficients[down * (njets + 1) + ntags]};
+}
+
+// same with the first njets of a jet collection, i.e. jet_factory::getBtagJets
+btag_event_weight btag_weights::weight(std::vector<jet>& jets, int njets, int ntags) const {
+  njets = njets < 0 ? 0 : njets > static_cast<int>(jets.size()) ? jets.size() : njets;
+  double fixed_pt[max_jets];
+  int fixed_flavour[max_jets];
+  std::vector<double> large_pt;
+  std::vector<int> large_flavour;
+  if (njets > max_jets) {
+    large_pt.resize(njets);
+    large_flavour.resize(njets);
+  }
+  double *pt = njets > max_jets ? large_pt.data() : fixed_pt;
+  int *flavour = njets > max_jets ? large_flavour.data() : fixed_flavour;
+  for (int j = 0; j < njets; j++) {
+    pt[j] = jets[j].getPt();
+    flavour[j] = int(jets[j].getFlavor());
+  }
+  return weight(pt, flavour, njets, ntags);
+}
+
+// largest difference to the sum over every tag assignment with GetSF, for n
+// pseudo-events of 1 to 6 jets spread over the pT range and all flavours
+double btag_weights::check(int n) const {
+  int flavours[] = {5, 4, 0};
+  double largest[n_shifts] = {0., 0., 0.};
+  for (int e = 0; e < n; e++) {
+    int njets = 1 + e % 6;
+    double pt[6];
+    int flavour[6];
+    for (int j = 0; j < njets; j++) {
+      // jet pT are floats, as in the ntuples and in GetSF
+      pt[j] = float(20. + std::fmod(37.3 * e + 91.7 * j, max_pt - 20.));
+      flavour[j] = flavours[(e + j) % 3];
+    }
+    for (int ntags = 0; ntags <= njets; ntags++) {
+      auto result = weight(pt, flavour, njets, ntags);
+      double values[n_shifts] = {result.nominal, result.up, result.down};
+      for (int s = 0; s < n_shifts; s++) {
+        double brute(0.);
+        for (int mask = 0; mask < (1 << njets); mask++) {
+          if (__builtin_popcount(mask) != ntags) {
+            continue;
+          }
+          double probability(1.);
+          for (int j = 0; j < njets; j++) {
+            double sf = GetSF(wp, pt[j], flavour[j], getSyst(s));
+            probability *= mask >> j & 1 ? sf : 1 - sf;
+          }
+          brute += probability;
+        }
+        largest[s] = std::max(largest[s], std::fabs(values[s] - brute));
+      }
+    }
+  }
+  std::cout << "b-tag event weights: largest difference to the brute force sum " << largest[nominal]
+            << " (nominal), " << largest[up] << " (up), " << largest[down] << " (down)" << std::endl;
+  return std::max(largest[nominal], std::max(largest[up], largest[down]));
+}
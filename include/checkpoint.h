@@ -0,0 +1,129 @@
+#include <string>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include "TFile.h"
+#include "TNamed.h"
+#include "TParameter.h"
+#include "TH1F.h"
+#include "TH2F.h"
+
+///////////////////////////////////////////////////////
+// Purpose: To periodically save the histograms and  //
+// the next entry to process so an interrupted job   //
+// can pick up where it stopped                      //
+///////////////////////////////////////////////////////
+class checkpoint {
+private:
+  std::string ckpt_name, key;
+  Long64_t every, start;
+  lazy_histos_1d *histos_1d;
+  lazy_histos_2d *histos_2d;
+  std::function<void()> before_write;
+
+  void write(Long64_t);
+
+public:
+  checkpoint (std::string, std::string, Long64_t, lazy_histos_1d*, lazy_histos_2d*);
+  virtual ~checkpoint () {};
+
+  // i.e. to flush fills that are not in the histograms yet
+  void setBeforeWrite(std::function<void()> f) { before_write = f; };
+
+  Long64_t restore(Long64_t);
+  void update(Long64_t);
+  void finish();
+};
+
+// every = 0 turns checkpointing off
+checkpoint::checkpoint(std::string output_name, std::string job_key, Long64_t n, lazy_histos_1d *h1, lazy_histos_2d *h2) :
+  ckpt_name(output_name + ".ckpt"),
+  key(job_key),
+  every(n),
+  start(0),
+  histos_1d(h1),
+  histos_2d(h2)
+  {}
+
+// fill the histograms from an existing checkpoint and return
+// the entry to start from (first if there is nothing to resume)
+Long64_t checkpoint::restore(Long64_t first) {
+  start = first;
+  if (every <= 0) {
+    return start;
+  }
+
+  auto dir = gDirectory;
+  auto fckpt = TFile::Open(ckpt_name.c_str(), "READ");
+  if (!fckpt || fckpt->IsZombie()) {
+    dir->cd();
+    return start;
+  }
+
+  auto stored_key = (TNamed*)fckpt->Get("key");
+  auto next = (TParameter<Long64_t>*)fckpt->Get("next");
+  if (stored_key && next && key == stored_key->GetTitle()) {
+    // only histograms booked before the checkpoint are in it
+    for (auto& key : histos_1d->getKeys()) {
+      auto saved = (TH1F*)fckpt->Get(("h1_" + key).c_str());
+      if (saved) {
+        histos_1d->at(key)->Add(saved);
+      }
+    }
+    for (auto& key : histos_2d->getKeys()) {
+      auto saved = (TH2F*)fckpt->Get(("h2_" + key).c_str());
+      if (saved) {
+        histos_2d->at(key)->Add(saved);
+      }
+    }
+    start = next->GetVal();
+    std::cout << "Resuming from checkpoint " << ckpt_name << " at entry " << start << std::endl;
+  } else {
+    std::cout << "Ignoring checkpoint " << ckpt_name << " from a different job" << std::endl;
+  }
+  fckpt->Close();
+  dir->cd();
+  return start;
+}
+
+// call at the top of the event loop, before entry i is processed
+void checkpoint::update(Long64_t i) {
+  if (every > 0 && i > start && (i - start) % every == 0) {
+    write(i);
+  }
+}
+
+// write to a temporary file first so a crash while
+// writing never destroys the previous checkpoint
+void checkpoint::write(Long64_t next) {
+  if (before_write) {
+    before_write();
+  }
+  auto dir = gDirectory;
+  std::string tmp_name = ckpt_name + ".tmp";
+  auto fckpt = new TFile(tmp_name.c_str(), "RECREATE");
+  TNamed stored_key("key", key.c_str());
+  stored_key.Write();
+  TParameter<Long64_t> stored_next("next", next);
+  stored_next.Write();
+  for (auto& h : *histos_1d) {
+    fckpt->WriteTObject(h.second, ("h1_" + h.first).c_str());
+  }
+  for (auto& h : *histos_2d) {
+    fckpt->WriteTObject(h.second, ("h2_" + h.first).c_str());
+  }
+  fckpt->Close();
+  dir->cd();
+
+  if (std::rename(tmp_name.c_str(), ckpt_name.c_str()) != 0) {
+    std::cerr << "Unable to write checkpoint " << ckpt_name << std::endl;
+  }
+}
+
+// the job finished, the checkpoint is no longer needed
+void checkpoint::finish() {
+  if (every > 0) {
+    std::remove(ckpt_name.c_str());
+  }
+}
@@ -0,0 +1,187 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To read the uncompressed column files made  //
+// by column_converter.cc. The file is memory-mapped,   //
+// so repeated passes read straight from the page cache //
+// without decompression or streamers.                  //
+//   --columns FILE : read entries from FILE instead of //
+//                    the input tree                    //
+// Layout: column_header, ncolumns column_info, then    //
+// one array per branch starting on a 64-byte boundary. //
+// The file is tied to the UUID, size and mtime of its  //
+// input, and every column to the type and size of its  //
+// leaf, so a stale file is never read. The extent of   //
+// every column is checked against the file size, so a  //
+// truncated file is not read either.                   //
+//////////////////////////////////////////////////////////
+struct column_header {
+  char magic[8];      // "HTTCOLS2"
+  char input[128];    // skim_cache::fileID of the ROOT file the columns came from
+  double nevents;     // generated events, bin 2 of "nevents"
+  Long64_t entries;
+  Long64_t ncolumns;
+};
+
+struct column_info {
+  char name[96];
+  char type[16];      // leaf type, i.e. Float_t
+  Long64_t size;      // bytes per entry
+  Long64_t offset;    // from the start of the file
+};
+
+static const char column_magic[8] = {'H', 'T', 'T', 'C', 'O', 'L', 'S', '2'};
+
+class column_reader {
+private:
+  struct binding {
+    char *address;      // where the factories expect the value
+    const char *data;   // start of the column in the mapping
+    size_t size;
+  };
+
+  bool valid;
+  std::string file_name;
+  char *mapping;
+  size_t mapped_size;
+  const column_header *header;
+  const column_info *infos;
+  std::vector<binding> bindings;
+
+public:
+  column_reader (CLParser&, TFile*);
+  virtual ~column_reader ();
+
+  // getters
+  bool isValid()          { return valid;                               };
+  double getNevents()     { return valid ? header->nevents : 0.;        };
+  Long64_t getEntries()   { return valid ? header->entries : 0;         };
+
+  bool bind(TTree*);
+  void load(Long64_t);
+};
+
+// map the file and check it was made from this input
+column_reader::column_reader(CLParser& parser, TFile* fin) :
+  valid(false),
+  file_name(parser.Option("--columns")),
+  mapping(nullptr),
+  mapped_size(0),
+  header(nullptr),
+  infos(nullptr)
+{
+  if (file_name.empty()) {
+    return;
+  }
+
+  int fd = open(file_name.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(column_header)) {
+    std::cerr << "Unable to read column file " << file_name << ", reading the tree instead" << std::endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return;
+  }
+
+  mapped_size = info.st_size;
+  void *addr = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "Unable to map column file " << file_name << ", reading the tree instead" << std::endl;
+    return;
+  }
+  mapping = static_cast<char*>(addr);
+  madvise(mapping, mapped_size, MADV_SEQUENTIAL);
+
+  header = reinterpret_cast<const column_header*>(mapping);
+  infos = reinterpret_cast<const column_info*>(mapping + sizeof(column_header));
+  if (std::memcmp(header->magic, column_magic, sizeof(column_magic)) != 0) {
+    std::cerr << file_name << " is not a column file, reading the tree instead" << std::endl;
+    return;
+  }
+  if (std::string(header->input, strnlen(header->input, sizeof(header->input))) != skim_cache::fileID(fin)) {
+    std::cerr << file_name << " was made from a different or changed input file, reading the tree instead" << std::endl;
+    return;
+  }
+
+  // a truncated or half-written file must not be read past its end
+  bool complete = header->entries >= 0 && header->ncolumns >= 0 &&
+    header->ncolumns <= static_cast<Long64_t>((mapped_size - sizeof(column_header)) / sizeof(column_info));
+  for (Long64_t i = 0; complete && i < header->ncolumns; i++) {
+    auto& column = infos[i];
+    complete = column.size > 0 && column.offset >= 0 && static_cast<size_t>(column.offset) <= mapped_size &&
+      header->entries <= static_cast<Long64_t>((mapped_size - column.offset) / column.size);
+  }
+  if (!complete) {
+    std::cerr << file_name << " is truncated or corrupt, reading the tree instead" << std::endl;
+    return;
+  }
+  valid = true;
+}
+
+column_reader::~column_reader() {
+  if (mapping) {
+    munmap(mapping, mapped_size);
+  }
+}
+
+// point every branch the factories bound at its column. Returns false (and
+// reads the tree from then on) if a branch is missing or its type changed
+bool column_reader::bind(TTree* input) {
+  if (!valid) {
+    return false;
+  }
+  if (header->entries != input->GetEntries()) {
+    std::cerr << file_name << " does not hold the same entries as the input, reading the tree instead" << std::endl;
+    valid = false;
+    return false;
+  }
+
+  for (auto branch : tree_io::activeBranches(input)) {
+    const column_info *found = nullptr;
+    for (Long64_t i = 0; i < header->ncolumns; i++) {
+      if (branch->GetName() == std::string(infos[i].name, strnlen(infos[i].name, sizeof(infos[i].name)))) {
+        found = &infos[i];
+        break;
+      }
+    }
+    if (!found) {
+      std::cerr << "Branch " << branch->GetName() << " is not in " << file_name << ", reading the tree instead" << std::endl;
+      bindings.clear();
+      valid = false;
+      return false;
+    }
+    auto leaves = branch->GetListOfLeaves();
+    auto leaf = leaves->GetEntriesFast() == 1 ? (TLeaf*)leaves->At(0) : nullptr;
+    if (!leaf || std::string(found->type, strnlen(found->type, sizeof(found->type))) != leaf->GetTypeName() ||
+        found->size != static_cast<Long64_t>(leaf->GetLenType()) * leaf->GetLen()) {
+      std::cerr << "Branch " << branch->GetName() << " does not match its column in " << file_name << ", reading the tree instead" << std::endl;
+      bindings.clear();
+      valid = false;
+      return false;
+    }
+    bindings.push_back({branch->GetAddress(), mapping + found->offset, static_cast<size_t>(found->size)});
+  }
+
+  std::cout << "Reading " << bindings.size() << " columns of " << header->entries << " entries from " << file_name << std::endl;
+  return true;
+}
+
+// same as TTree::GetEntry for the bound branches
+void column_reader::load(Long64_t entry) {
+  for (auto& b : bindings) {
+    std::memcpy(b.address, b.data + entry * b.size, b.size);
+  }
+}
@@ -0,0 +1,323 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#include "TFile.h"
+#include "TTree.h"
+
+//////////////////////////////////////////////////////////////
+// Purpose: To index the input by (run, lumi, evt) for lumi //
+// masks, duplicate removal and single event lookup. The    //
+// sorted index of each file is kept in a sidecar file in   //
+// cache/, so it is only built (from the run, lumi and evt  //
+// branches) the first time an input is used. Entries are   //
+// numbered across all files of the chain.                  //
+//   --lumi-mask FILE     : golden JSON of certified lumis  //
+//   --dedup              : drop repeated events, keeping   //
+//                          the first entry                 //
+//   --overlap-with A,B   : drop events also found in the   //
+//                          files A, B, ... (other streams) //
+//   --event run:lumi:evt : only process this event         //
+// Without any of these the index is never built. If an     //
+// input can't be indexed, the mask can't be read or the    //
+// event is malformed or not found, the index is not valid  //
+// and the job has to stop, so nothing is silently dropped  //
+// or written empty.                                        //
+//////////////////////////////////////////////////////////////
+class event_index {
+private:
+  struct record {
+    UInt_t run, lumi;
+    ULong64_t evt;
+    Long64_t entry;
+
+    bool operator<(const record& other) const {
+      if (run != other.run) return run < other.run;
+      if (lumi != other.lumi) return lumi < other.lumi;
+      if (evt != other.evt) return evt < other.evt;
+      return entry < other.entry;
+    }
+    bool same(const record& other) const {
+      return run == other.run && lumi == other.lumi && evt == other.evt;
+    }
+  };
+
+  bool valid, active, single;
+  Long64_t selected;
+  std::string tree_name, key, label;
+  std::vector<record> records;
+  std::vector<bool> rejected;
+  std::map<UInt_t, std::vector<std::pair<UInt_t, UInt_t>>> lumi_mask;
+
+  bool load(std::string, std::vector<record>&);
+  bool readMask(std::string);
+  bool inMask(UInt_t, UInt_t);
+
+public:
+  event_index (CLParser&, std::vector<std::string>, std::string);
+  virtual ~event_index () {};
+
+  // getters
+  bool isValid()                { return valid;                               };
+  bool isSingleEvent()          { return single;                              };
+  Long64_t getSelected()        { return selected;                            };
+  std::string getKey()          { return key;                                 };
+  std::string getLabel()        { return label;                               };
+  bool accept(Long64_t entry)   { return !active || !rejected.at(entry);      };
+
+  Long64_t find(UInt_t, UInt_t, ULong64_t);
+};
+
+event_index::event_index(CLParser& parser, std::vector<std::string> file_names, std::string tree) :
+  valid(false),
+  active(false),
+  single(false),
+  selected(-1),
+  tree_name(tree),
+  key(""),
+  label("")
+{
+  std::string mask_name = parser.Option("--lumi-mask");
+  std::string overlap = parser.Option("--overlap-with");
+  std::string event = parser.Option("--event");
+  bool dedup = parser.Flag("--dedup");
+  if (mask_name.empty() && overlap.empty() && event.empty() && !dedup) {
+    valid = true;
+    return;
+  }
+
+  // chain entries continue where the previous file stopped
+  Long64_t offset(0);
+  for (auto& fname : file_names) {
+    std::vector<record> part;
+    if (!load(fname, part)) {
+      return;
+    }
+    for (auto& rec : part) {
+      rec.entry += offset;
+      records.push_back(rec);
+    }
+    offset += part.size();
+  }
+  if (file_names.size() > 1) {
+    std::sort(records.begin(), records.end());
+  }
+  active = true;
+  rejected.assign(records.size(), false);
+
+  // single event lookup
+  if (!event.empty()) {
+    unsigned run(0), lumi(0);
+    unsigned long long evt(0);
+    single = true;
+    if (sscanf(event.c_str(), "%u:%u:%llu", &run, &lumi, &evt) != 3) {
+      std::cerr << "Bad event " << event << ", expected run:lumi:evt" << std::endl;
+      return;
+    }
+    selected = find(run, lumi, evt);
+    if (selected < 0) {
+      std::cerr << "Event " << event << " is not in the input" << std::endl;
+      return;
+    }
+    label = "_evt" + std::to_string(run) + "_" + std::to_string(lumi) + "_" + std::to_string(evt);
+    std::cout << "Event " << event << " is entry " << selected << std::endl;
+  }
+
+  // certified lumi sections
+  Long64_t n_masked(0), n_duplicate(0), n_overlap(0);
+  if (!mask_name.empty()) {
+    if (!readMask(mask_name)) {
+      std::cerr << "Unable to read lumi mask " << mask_name << std::endl;
+      return;
+    }
+    for (auto& rec : records) {
+      if (!inMask(rec.run, rec.lumi)) {
+        rejected.at(rec.entry) = true;
+        n_masked++;
+      }
+    }
+    std::ifstream mask_file(mask_name);
+    std::stringstream ss;
+    ss << mask_file.rdbuf();
+    key += ":mask(" + std::to_string(skim_cache::hash(ss.str())) + ")";
+  }
+
+  // records are sorted, so repeated events (also from different files of
+  // the chain) are neighbours and the lowest entry comes first
+  if (dedup) {
+    for (size_t i = 1; i < records.size(); i++) {
+      if (records.at(i).same(records.at(i - 1))) {
+        rejected.at(records.at(i).entry) = true;
+        n_duplicate++;
+      }
+    }
+    key += ":dedup";
+  }
+
+  // events already in other files, found by walking both sorted indices together
+  if (!overlap.empty()) {
+    std::stringstream ss(overlap);
+    std::string other_name;
+    while (std::getline(ss, other_name, ',')) {
+      std::vector<record> other;
+      if (!load(other_name, other)) {
+        return;
+      }
+      auto it = other.begin();
+      for (auto& rec : records) {
+        while (it != other.end() && *it < rec && !it->same(rec)) {
+          ++it;
+        }
+        if (it != other.end() && it->same(rec) && !rejected.at(rec.entry)) {
+          rejected.at(rec.entry) = true;
+          n_overlap++;
+        }
+      }
+      key += ":overlap(" + other_name + ")";
+    }
+  }
+
+  std::cout << "Event index: " << records.size() << " entries, " << n_masked << " outside the lumi mask, "
+            << n_duplicate << " duplicates, " << n_overlap << " found in other files" << std::endl;
+  valid = true;
+}
+
+// read the sorted index from the sidecar, or build it from the run, lumi and evt
+// branches. False if the file can't be indexed; an empty file has an empty index
+bool event_index::load(std::string fname, std::vector<record>& index) {
+  index.clear();
+  auto dir = gDirectory;
+  auto fidx = TFile::Open(fname.c_str(), "READ");
+  if (!fidx || fidx->IsZombie()) {
+    std::cerr << "Unable to open " << fname << " to index it" << std::endl;
+    dir->cd();
+    return false;
+  }
+
+  std::stringstream ss;
+  ss << "cache/index_" << std::hex << skim_cache::hash(skim_cache::fileID(fidx) + "|" + tree_name) << ".idx";
+  std::string sidecar = ss.str();
+
+  auto fside = fopen(sidecar.c_str(), "rb");
+  if (fside) {
+    char magic[8];
+    Long64_t n(0);
+    bool good = fread(magic, 1, 8, fside) == 8 && std::memcmp(magic, "HTTIDX1", 8) == 0 && fread(&n, sizeof(n), 1, fside) == 1 && n >= 0;
+    if (good) {
+      index.resize(n);
+      good = fread(index.data(), sizeof(record), n, fside) == static_cast<size_t>(n);
+    }
+    fclose(fside);
+    if (good) {
+      fidx->Close();
+      dir->cd();
+      return true;
+    }
+    index.clear();
+  }
+
+  std::cout << "Indexing " << fname << std::endl;
+  auto tree = (TTree*)fidx->Get(tree_name.c_str());
+  if (!tree) {
+    std::cerr << "No " << tree_name << " in " << fname << " to index" << std::endl;
+    fidx->Close();
+    dir->cd();
+    return false;
+  }
+  UInt_t run, lumi;
+  ULong64_t evt;
+  tree->SetBranchStatus("*", 0);
+  tree->SetBranchStatus("run", 1);
+  tree->SetBranchStatus("lumi", 1);
+  tree->SetBranchStatus("evt", 1);
+  tree->SetBranchAddress("run", &run);
+  tree->SetBranchAddress("lumi", &lumi);
+  tree->SetBranchAddress("evt", &evt);
+  Long64_t nentries = tree->GetEntries();
+  index.reserve(nentries);
+  for (Long64_t i = 0; i < nentries; i++) {
+    tree->GetEntry(i);
+    index.push_back({run, lumi, evt, i});
+  }
+  std::sort(index.begin(), index.end());
+  fidx->Close();
+  dir->cd();
+
+  // write to a temporary file first so an interrupted job never leaves a bad index
+  mkdir("cache", 0755);
+  std::string tmp_name = sidecar + ".tmp";
+  fside = fopen(tmp_name.c_str(), "wb");
+  Long64_t n = index.size();
+  if (!fside || fwrite("HTTIDX1", 1, 8, fside) != 8 || fwrite(&n, sizeof(n), 1, fside) != 1 ||
+      fwrite(index.data(), sizeof(record), n, fside) != static_cast<size_t>(n) || fclose(fside) != 0 ||
+      std::rename(tmp_name.c_str(), sidecar.c_str()) != 0) {
+    std::cerr << "Unable to write event index " << sidecar << std::endl;
+  }
+  return true;
+}
+
+// entry holding (run, lumi, evt), -1 if it is not in the input
+Long64_t event_index::find(UInt_t run, UInt_t lumi, ULong64_t evt) {
+  record target {run, lumi, evt, 0};
+  auto it = std::lower_bound(records.begin(), records.end(), target);
+  if (it != records.end() && it->same(target)) {
+    return it->entry;
+  }
+  return -1;
+}
+
+// golden JSON: {"run": [[first, last], [first, last], ...], ...}
+bool event_index::readMask(std::string mask_name) {
+  std::ifstream mask_file(mask_name);
+  if (!mask_file) {
+    return false;
+  }
+  std::stringstream ss;
+  ss << mask_file.rdbuf();
+  std::string text = ss.str();
+
+  size_t pos = 0;
+  while ((pos = text.find('"', pos)) != std::string::npos) {
+    size_t end = text.find('"', pos + 1);
+    size_t close = text.find("]]", end);
+    if (end == std::string::npos || close == std::string::npos) {
+      return false;
+    }
+    UInt_t run = std::stoul(text.substr(pos + 1, end - pos - 1));
+
+    // lumi ranges come in pairs of numbers
+    std::vector<UInt_t> numbers;
+    for (size_t i = end + 1; i < close; i++) {
+      if (isdigit(text[i])) {
+        size_t len(0);
+        numbers.push_back(std::stoul(text.substr(i, close - i), &len));
+        i += len - 1;
+      }
+    }
+    for (size_t i = 0; i + 1 < numbers.size(); i += 2) {
+      lumi_mask[run].push_back({numbers.at(i), numbers.at(i + 1)});
+    }
+    pos = close;
+  }
+  return !lumi_mask.empty();
+}
+
+bool event_index::inMask(UInt_t run, UInt_t lumi) {
+  auto found = lumi_mask.find(run);
+  if (found == lumi_mask.end()) {
+    return false;
+  }
+  for (auto& range : found->second) {
+    if (lumi >= range.first && lumi <= range.second) {
+      return true;
+    }
+  }
+  return false;
+}
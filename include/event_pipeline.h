@@ -0,0 +1,217 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstring>
+#include <iostream>
+#include <condition_variable>
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To read and decompress upcoming entries on  //
+// a separate thread while the main thread runs the     //
+// physics. The reader thread uses its own file handles //
+// and fills blocks of entries into a ring buffer of    //
+// fixed depth, so it waits whenever it gets ahead.     //
+// load(i) copies one entry into the addresses the      //
+// factories bound, just like TTree::GetEntry. Entries  //
+// come from the column file instead when one is bound. //
+//   --pipeline           : turn the reader thread on   //
+//   --pipeline-block N   : entries per block (256)     //
+//   --pipeline-depth N   : blocks in the ring (8)      //
+//////////////////////////////////////////////////////////
+class event_pipeline {
+private:
+  struct column {
+    std::string name;
+    char *address;  // where the factories expect the value
+    size_t size, offset;
+  };
+
+  struct block {
+    std::vector<char> data;
+    std::vector<Long64_t> entries;
+    size_t n;
+  };
+
+  TTree *tree;
+  skim_cache *cache;
+  column_reader *column_file;
+  bool threaded;
+  Long64_t first, last;
+  std::vector<column> columns;
+  size_t row_size, block_size;
+
+  // ring buffer shared by the two threads
+  std::vector<block> ring;
+  size_t head, tail, count, current;
+  bool stop;
+  std::mutex mtx;
+  std::condition_variable not_full, not_empty;
+  std::thread reader;
+
+  TChain *reader_tree;
+
+  void read();
+
+public:
+  event_pipeline (TTree*, std::vector<std::string>, std::string, skim_cache*, column_reader*, Long64_t, Long64_t, CLParser&);
+  virtual ~event_pipeline ();
+
+  Long64_t load(Long64_t);
+};
+
+event_pipeline::event_pipeline(TTree* input, std::vector<std::string> file_names, std::string tree_name, skim_cache* skim, column_reader* col_file, Long64_t first_pos, Long64_t last_pos, CLParser& parser) :
+  tree(input),
+  cache(skim),
+  column_file(col_file),
+  threaded(parser.Flag("--pipeline")),
+  first(first_pos),
+  last(last_pos),
+  row_size(0),
+  block_size(256),
+  head(0),
+  tail(0),
+  count(0),
+  current(0),
+  stop(false),
+  reader_tree(nullptr)
+{
+  // the column file is already uncompressed, nothing to gain from the thread
+  if (!threaded || last <= first || column_file->isValid()) {
+    threaded = false;
+    return;
+  }
+
+  std::string block_opt = parser.Option("--pipeline-block");
+  std::string depth_opt = parser.Option("--pipeline-depth");
+  if (!block_opt.empty()) {
+    block_size = std::max(1, std::stoi(block_opt));
+  }
+  size_t depth = depth_opt.empty() ? 8 : std::max(2, std::stoi(depth_opt));
+
+  // one column per branch bound by the factories
+  for (auto branch : tree_io::activeBranches(tree)) {
+    auto leaf = (TLeaf*)branch->GetListOfLeaves()->At(0);
+    size_t size = leaf->GetLenType() * leaf->GetLen();
+    columns.push_back({branch->GetName(), branch->GetAddress(), size, row_size});
+    row_size += size;
+  }
+
+  ROOT::EnableThreadSafety();
+  reader_tree = new TChain(tree_name.c_str());
+  for (auto& fname : file_names) {
+    reader_tree->Add(fname.c_str());
+  }
+  if (reader_tree->LoadTree(0) < 0) {
+    std::cerr << "Unable to open the input for the reader thread, reading directly" << std::endl;
+    threaded = false;
+    return;
+  }
+  reader_tree->SetBranchStatus("*", 0);
+  for (auto& col : columns) {
+    reader_tree->SetBranchStatus(col.name.c_str(), 1);
+  }
+  reader_tree->SetCacheSize(30 * 1024 * 1024);
+  for (auto& col : columns) {
+    reader_tree->AddBranchToCache(col.name.c_str(), false);
+  }
+  reader_tree->StopCacheLearningPhase();
+
+  ring.resize(depth);
+  for (auto& b : ring) {
+    b.data.resize(block_size * row_size);
+    b.entries.resize(block_size);
+    b.n = 0;
+  }
+
+  std::cout << "Reading " << columns.size() << " branches on a separate thread ("
+            << depth << " blocks of " << block_size << " entries)" << std::endl;
+  reader = std::thread(&event_pipeline::read, this);
+}
+
+event_pipeline::~event_pipeline() {
+  if (reader.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    not_full.notify_all();
+    reader.join();
+  }
+  delete reader_tree;
+}
+
+// reader thread: fill blocks until the range is done
+void event_pipeline::read() {
+  std::vector<char> staging(row_size);
+  for (auto& col : columns) {
+    reader_tree->SetBranchAddress(col.name.c_str(), (void*)&staging[col.offset]);
+  }
+
+  Long64_t pos = first;
+  while (pos < last) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      not_full.wait(lock, [this] { return count < ring.size() || stop; });
+      if (stop) {
+        return;
+      }
+    }
+
+    // the slot at head is not visible to the main thread until count grows
+    auto& b = ring[head];
+    b.n = 0;
+    for (; pos < last && b.n < block_size; pos++, b.n++) {
+      Long64_t entry = cache->getEntry(pos);
+      reader_tree->GetEntry(entry);
+      std::memcpy(&b.data[b.n * row_size], staging.data(), row_size);
+      b.entries[b.n] = entry;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      head = (head + 1) % ring.size();
+      count++;
+    }
+    not_empty.notify_one();
+  }
+}
+
+// make position i the current entry and return its entry number.
+// Positions must be loaded in order when the reader thread is used
+Long64_t event_pipeline::load(Long64_t i) {
+  if (!threaded) {
+    Long64_t entry = cache->getEntry(i);
+    if (column_file->isValid()) {
+      column_file->load(entry);
+    } else {
+      tree->GetEntry(entry);
+    }
+    return entry;
+  }
+
+  // the first call, or the current block has been used up
+  if (i == first || current == ring[tail].n) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (i != first) {
+      tail = (tail + 1) % ring.size();
+      count--;
+      not_full.notify_one();
+    }
+    not_empty.wait(lock, [this] { return count > 0; });
+    current = 0;
+  }
+
+  auto& b = ring[tail];
+  const char *row = &b.data[current * row_size];
+  for (auto& col : columns) {
+    std::memcpy(col.address, row + col.offset, col.size);
+  }
+  return b.entries[current++];
+}
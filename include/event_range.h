@@ -0,0 +1,101 @@
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+//////////////////////////////////////////////////////
+// Purpose: To select the block of entries a job    //
+// processes so one sample can be split into shards //
+//   --first N --last M : entries N <= i < M        //
+//   --shard k/N        : k-th of N equal blocks    //
+//                        (k counts from 0)         //
+// A malformed range is an error, so a broken shard //
+// job never processes (and writes) the full sample //
+//////////////////////////////////////////////////////
+class event_range {
+private:
+  bool valid;
+  Long64_t first, last, nevts;
+  std::string label;
+
+  static bool readNumber(std::string, long long&);
+
+public:
+  event_range (CLParser&, Long64_t);
+  virtual ~event_range () {};
+
+  // getters
+  bool isValid()          { return valid;                            };
+  Long64_t getFirst()     { return first;                            };
+  Long64_t getLast()      { return last;                             };
+  std::string getLabel()  { return label;                            };
+  bool isFull()           { return first == 0 && last == nevts;      };
+
+  void select(Long64_t, std::string);
+};
+
+event_range::event_range(CLParser& parser, Long64_t n) :
+  valid(false),
+  first(0),
+  last(n),
+  nevts(n),
+  label("")
+{
+  std::string shard = parser.Option("--shard");
+  std::string first_opt = parser.Option("--first");
+  std::string last_opt = parser.Option("--last");
+
+  if (!shard.empty()) {
+    long long k(0), nshards(1);
+    auto slash = shard.find('/');
+    if (slash == std::string::npos || !readNumber(shard.substr(0, slash), k) || !readNumber(shard.substr(slash + 1), nshards) ||
+        nshards < 1 || k < 0 || k >= nshards) {
+      std::cerr << "Bad shard " << shard << ", expected k/N with 0 <= k < N" << std::endl;
+      return;
+    }
+    first = k * nevts / nshards;
+    last = (k + 1) * nevts / nshards;
+    label = "_shard" + std::to_string(k) + "of" + std::to_string(nshards);
+  } else if (!first_opt.empty() || !last_opt.empty()) {
+    long long value(0);
+    if (!first_opt.empty()) {
+      if (!readNumber(first_opt, value) || value < 0) {
+        std::cerr << "Bad --first " << first_opt << ", expected an entry number" << std::endl;
+        return;
+      }
+      first = value;
+    }
+    if (!last_opt.empty()) {
+      if (!readNumber(last_opt, value) || value < 0) {
+        std::cerr << "Bad --last " << last_opt << ", expected an entry number" << std::endl;
+        return;
+      }
+      last = std::min(nevts, static_cast<Long64_t>(value));
+    }
+    first = std::min(first, last);
+    label = "_" + std::to_string(first) + "to" + std::to_string(last);
+  }
+
+  if (!isFull()) {
+    std::cout << "Processing entries " << first << " to " << last << " of " << nevts << std::endl;
+  }
+  valid = true;
+}
+
+// a whole string holding a decimal integer
+bool event_range::readNumber(std::string text, long long& value) {
+  if (text.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  value = std::strtoll(text.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+// only process a single entry (nothing if it is negative)
+void event_range::select(Long64_t entry, std::string entry_label) {
+  first = std::max(0LL, entry);
+  last = entry < 0 ? first : entry + 1;
+  label = entry_label;
+}
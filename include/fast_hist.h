@@ -0,0 +1,225 @@
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include "TH1.h"
+#include "TArrayD.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To fill histograms inside the event loop    //
+// without going through TH1::Fill. A fast_hist keeps   //
+// contiguous sum of weights and sum of weights^2       //
+// arrays indexed by the ROOT global bin, and finds     //
+// bins with a fast_axis: one multiplication for        //
+// uniform binning, a small lookup table plus at most a //
+// step or two for variable edges. Fills can be made    //
+// one at a time (returning the global bin) or buffered //
+// and binned in batches. flush() adds everything to    //
+// the ROOT histogram it was made from, which is only   //
+// needed before the histogram is written. Histograms   //
+// made sparse only keep the bins that were filled, in  //
+// a hash map, so their memory and flush() time follow  //
+// the number of filled bins rather than the binning.   //
+// A fast_hist can be made without its ROOT histogram   //
+// (setTarget(nullptr)) and given one only if it turns  //
+// out to be filled.                                    //
+//////////////////////////////////////////////////////////
+class fast_axis {
+private:
+  int nbins;
+  double low, high, scale;
+  bool uniform;
+  std::vector<double> edges;
+  std::vector<int> lut;             // bin below the low edge of each lookup cell
+
+public:
+  fast_axis (const TAxis*);
+  virtual ~fast_axis () {};
+
+  // getters
+  int getNbins()      { return nbins; };
+
+  // same bin as TAxis::FindFixBin, 0 for underflow and nbins + 1 for overflow
+  int find(double x) const {
+    if (x < low) {
+      return 0;
+    }
+    if (!(x < high)) {
+      return nbins + 1;
+    }
+    if (uniform) {
+      int bin = 1 + int(nbins * (x - low) / (high - low));
+      return bin > nbins ? nbins : bin;
+    }
+    int bin = lut[std::min(int((x - low) * scale), static_cast<int>(lut.size()) - 1)];
+    while (bin > 0 && x < edges[bin]) {
+      bin--;
+    }
+    while (x >= edges[bin + 1]) {
+      bin++;
+    }
+    return bin + 1;
+  }
+};
+
+fast_axis::fast_axis(const TAxis* axis) :
+  nbins(axis->GetNbins()),
+  low(axis->GetXmin()),
+  high(axis->GetXmax()),
+  scale(0.),
+  uniform(axis->GetXbins()->fN == 0)
+{
+  if (uniform) {
+    return;
+  }
+  edges.assign(axis->GetXbins()->GetArray(), axis->GetXbins()->GetArray() + nbins + 1);
+
+  // a few cells per bin keeps the walk from the cell to the bin short
+  int ncells = std::max(16, 4 * nbins);
+  scale = ncells / (high - low);
+  for (int cell = 0; cell < ncells; cell++) {
+    double cell_low = low + cell / scale;
+    int bin = std::upper_bound(edges.begin(), edges.end(), cell_low) - edges.begin() - 1;
+    lut.push_back(std::max(0, std::min(bin, nbins - 1)));
+  }
+}
+
+class fast_hist {
+private:
+  static const size_t buffer_size = 256;
+
+  TH1 *target;
+  fast_axis xaxis, yaxis;
+  int dimension, nx;
+  bool sparse, weighted;
+  Long64_t entries;
+  std::vector<double> contents, sumw2;      // by global bin, empty if sparse
+  std::unordered_map<Int_t, std::pair<double, double>> touched;   // sparse sums by global bin
+  std::vector<double> buffer_x, buffer_y, buffer_w;
+  std::vector<Int_t> buffer_bins;
+
+  void add(Int_t bin, double weight) {
+    if (sparse) {
+      auto& sums = touched[bin];
+      sums.first += weight;
+      sums.second += weight * weight;
+    } else {
+      contents[bin] += weight;
+      sumw2[bin] += weight * weight;
+    }
+    weighted = weighted || weight != 1.;
+    entries++;
+  }
+
+public:
+  fast_hist (TH1*, bool = false);
+  virtual ~fast_hist () {};
+
+  // getters
+  TH1* getTarget()      { return target;                              };
+  bool isSparse()       { return sparse;                              };
+  bool isEmpty()        { return entries == 0 && buffer_x.empty();    };
+
+  void setTarget(TH1* hist)   { target = hist; };
+
+  Int_t findBin(double x, double y) const {
+    return dimension == 1 ? xaxis.find(x) : xaxis.find(x) + (nx + 2) * yaxis.find(y);
+  }
+
+  // fill now and return the global bin
+  Int_t fill(double x, double y, double weight) {
+    Int_t bin = findBin(x, y);
+    add(bin, weight);
+    return bin;
+  }
+
+  void fill(const double*, const double*, const double*, size_t);
+  void push(double, double, double);
+  void drain();
+  void flush();
+};
+
+// the histogram must not change binning after this
+fast_hist::fast_hist(TH1* hist, bool is_sparse) :
+  target(hist),
+  xaxis(hist->GetXaxis()),
+  yaxis(hist->GetYaxis()),
+  dimension(hist->GetDimension()),
+  nx(hist->GetNbinsX()),
+  sparse(is_sparse),
+  weighted(false),
+  entries(0),
+  contents(sparse ? 0 : hist->GetNcells(), 0.),
+  sumw2(sparse ? 0 : hist->GetNcells(), 0.)
+{
+  buffer_x.reserve(buffer_size);
+  buffer_y.reserve(buffer_size);
+  buffer_w.reserve(buffer_size);
+  buffer_bins.resize(buffer_size);
+}
+
+// n fills at once, finding all bins before adding any of them
+void fast_hist::fill(const double* x, const double* y, const double* weight, size_t n) {
+  if (buffer_bins.size() < n) {
+    buffer_bins.resize(n);
+  }
+  for (size_t i = 0; i < n; i++) {
+    buffer_bins[i] = findBin(x[i], y ? y[i] : 0.);
+  }
+  for (size_t i = 0; i < n; i++) {
+    add(buffer_bins[i], weight[i]);
+  }
+}
+
+// fill later, in a batch of buffer_size fills
+void fast_hist::push(double x, double y, double weight) {
+  buffer_x.push_back(x);
+  buffer_y.push_back(y);
+  buffer_w.push_back(weight);
+  if (buffer_x.size() == buffer_size) {
+    drain();
+  }
+}
+
+void fast_hist::drain() {
+  fill(buffer_x.data(), buffer_y.data(), buffer_w.data(), buffer_x.size());
+  buffer_x.clear();
+  buffer_y.clear();
+  buffer_w.clear();
+}
+
+// add the fills since the last flush to the ROOT histogram
+void fast_hist::flush() {
+  drain();
+  if (entries == 0) {
+    return;
+  }
+  // TH1::Fill switches to weighted errors on the first weight != 1
+  if (weighted && target->GetSumw2N() == 0) {
+    target->Sumw2();
+  }
+  double *target_sumw2 = target->GetSumw2N() > 0 ? target->GetSumw2()->fArray : nullptr;
+  for (size_t bin = 0; bin < contents.size(); bin++) {
+    if (contents[bin] != 0. || sumw2[bin] != 0.) {
+      target->AddBinContent(bin, contents[bin]);
+      if (target_sumw2) {
+        target_sumw2[bin] += sumw2[bin];
+      }
+    }
+  }
+  for (auto& bin : touched) {
+    target->AddBinContent(bin.first, bin.second.first);
+    if (target_sumw2) {
+      target_sumw2[bin.first] += bin.second.second;
+    }
+  }
+  double total = target->GetEntries() + entries;
+  target->ResetStats();
+  target->SetEntries(total);
+
+  std::fill(contents.begin(), contents.end(), 0.);
+  std::fill(sumw2.begin(), sumw2.end(), 0.);
+  touched.clear();
+  weighted = false;
+  entries = 0;
+}
@@ -0,0 +1,152 @@
+#include <array>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include "TFile.h"
+#include "TChain.h"
+#include "TH1D.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To read one or more input files as a single //
+// chain. -s takes a comma-separated list of samples,   //
+// i.e. "DYJets,DYJets1,DYJets2", and each file keeps   //
+// its own generated-event count and cross section, so  //
+// getNorm(entry) is the lumi * xs / N normalization of //
+// the file that entry came from. getWeight(entry, n)   //
+// is the same, except for W and DY samples, which get  //
+// the stitching weight for n generated jets.           //
+//////////////////////////////////////////////////////////
+class input_chain {
+private:
+  bool valid;
+  std::vector<std::string> samples, file_names;
+  std::vector<TFile*> files;
+  std::vector<double> gen_numbers, norms;
+  std::vector<std::array<double, 5>> weights;  // by number of generated jets
+  std::vector<Long64_t> offsets;  // first chain entry of each file
+  TChain *chain;
+
+public:
+  input_chain (std::string, std::string, std::string, std::string);
+  virtual ~input_chain () {};
+
+  // getters
+  bool isValid()                          { return valid;                   };
+  TTree* getTree()                        { return chain;                   };
+  TFile* getFile(size_t i)                { return files.at(i);             };
+  size_t getNFiles()                      { return files.size();            };
+  std::vector<std::string> getFileNames() { return file_names;              };
+  std::vector<std::string> getSamples()   { return samples;                 };
+
+  std::string getName();
+  std::string getID();
+  void normalize(Helper&, bool, stitching&);
+  size_t getFileIndex(Long64_t);
+  double getNorm(Long64_t);
+  double getWeight(Long64_t, Float_t);
+  void close();
+};
+
+// open path + sample + postfix for every sample in the list
+input_chain::input_chain(std::string sample_list, std::string path, std::string postfix, std::string tree_name) :
+  valid(true),
+  chain(new TChain(tree_name.c_str()))
+{
+  std::stringstream ss(sample_list);
+  std::string sample;
+  Long64_t offset(0);
+  while (std::getline(ss, sample, ',')) {
+    std::string fname = path + sample + postfix;
+    std::cout << "Opening file... " << sample << std::endl;
+    auto fin = TFile::Open(fname.c_str());
+    if (!fin || fin->IsZombie() || !fin->Get(tree_name.c_str())) {
+      std::cerr << "Unable to read " << tree_name << " from " << fname << std::endl;
+      valid = false;
+      continue;
+    }
+
+    // get number of generated events, the sample table takes precedence
+    auto counts = (TH1D*)fin->Get("nevents");
+    auto info = sample_table::get().find(sample);
+    samples.push_back(sample);
+    file_names.push_back(fname);
+    files.push_back(fin);
+    gen_numbers.push_back(info && info->nevents > 0. ? info->nevents : counts->GetBinContent(2));
+    offsets.push_back(offset);
+    offset += ((TTree*)fin->Get(tree_name.c_str()))->GetEntries();
+    chain->Add(fname.c_str());
+  }
+
+  // factories bind their branches to the first tree
+  std::cout << "Loading Ntuple..." << std::endl;
+  chain->LoadTree(0);
+  norms.assign(files.size(), 1.);
+}
+
+// file names joined, to identify the job
+std::string input_chain::getName() {
+  std::string joined;
+  for (auto& fname : file_names) {
+    joined += (joined.empty() ? "" : ",") + fname;
+  }
+  return joined;
+}
+
+// identifies the contents of all files (see skim_cache::fileID)
+std::string input_chain::getID() {
+  std::string joined;
+  for (auto fin : files) {
+    joined += (joined.empty() ? "" : ",") + skim_cache::fileID(fin);
+  }
+  return joined;
+}
+
+// lumi * xs / N for each file (lumi & xs are in util.h)
+void input_chain::normalize(Helper& helper, bool isData, stitching& stitch) {
+  weights.clear();
+  for (size_t i = 0; i < files.size(); i++) {
+    if (isData) {
+      norms.at(i) = 1.0;
+    } else {
+      norms.at(i) = helper.getLuminosity() * helper.getCrossSection(samples.at(i)) / gen_numbers.at(i);
+    }
+
+    // stitched samples use the weight for the number of jets instead
+    auto table = stitch.getTable(samples.at(i));
+    if (table && !isData) {
+      weights.push_back(*table);
+    } else {
+      weights.push_back({norms.at(i), norms.at(i), norms.at(i), norms.at(i), norms.at(i)});
+    }
+    if (files.size() > 1) {
+      std::cout << "  " << samples.at(i) << ": " << gen_numbers.at(i) << " generated events, norm " << norms.at(i) << std::endl;
+    }
+  }
+}
+
+// file holding this chain entry
+size_t input_chain::getFileIndex(Long64_t entry) {
+  if (offsets.size() == 1) {
+    return 0;
+  }
+  return std::upper_bound(offsets.begin(), offsets.end(), entry) - offsets.begin() - 1;
+}
+
+// normalization of the file holding this chain entry
+double input_chain::getNorm(Long64_t entry) {
+  return norms.at(getFileIndex(entry));
+}
+
+// event weight before corrections, a table lookup without branching on the sample
+double input_chain::getWeight(Long64_t entry, Float_t n_gen_jets) {
+  return weights[getFileIndex(entry)][stitching::bin(n_gen_jets)];
+}
+
+void input_chain::close() {
+  delete chain;
+  for (auto fin : files) {
+    fin->Close();
+  }
+}
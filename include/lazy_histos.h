@@ -0,0 +1,112 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To book histograms the first time they are  //
+// used. Helper only lists the binning of every         //
+// histogram; at() creates it (and its directory) when  //
+// the analyzer first asks for it, so histograms a      //
+// channel never fills take no memory and are not       //
+// written. Iterating goes over the booked histograms   //
+// only. Helper::flush books all 2D templates anyway,   //
+// so only the control plots can be left out.           //
+//////////////////////////////////////////////////////////
+
+// uniform 1D histogram, booked in the directory of the container
+struct spec_1d {
+  std::string name, title;
+  int nbins;
+  double low, high;
+
+  int getNcells() const { return nbins + 2; };
+
+  TH1F* book(TDirectory* base) const {
+    base->cd();
+    return new TH1F(name.c_str(), title.c_str(), nbins, low, high);
+  }
+};
+
+// variable-bin 2D template, booked in its own directory
+struct spec_2d {
+  std::string dir, name, title;
+  std::vector<double> xbins, ybins;
+
+  int getNcells() const { return (xbins.size() + 1) * (ybins.size() + 1); };
+
+  TH2F* book(TDirectory* base) const {
+    if (!base->GetDirectory(dir.c_str())) {
+      base->mkdir(dir.c_str());
+    }
+    base->cd(dir.c_str());
+    return new TH2F(name.c_str(), title.c_str(), xbins.size() - 1, xbins.data(), ybins.size() - 1, ybins.data());
+  }
+};
+
+template <typename H, typename S>
+class lazy_histos {
+private:
+  TDirectory *base;
+  std::unordered_map<std::string, S> specs;
+  std::unordered_map<std::string, H*> booked;
+
+public:
+  typedef typename std::unordered_map<std::string, H*>::iterator iterator;
+
+  lazy_histos (TDirectory* dir, std::unordered_map<std::string, S> s) : base(dir), specs(s) {};
+  virtual ~lazy_histos () {};
+
+  // getters
+  bool has(std::string key)               { return specs.find(key) != specs.end();   };
+  bool isBooked(std::string key)          { return booked.find(key) != booked.end(); };
+  size_t size()                           { return booked.size();                    };
+  iterator begin()                        { return booked.begin();                   };
+  iterator end()                          { return booked.end();                     };
+
+  int getNcells(std::string key)          { return specs.at(key).getNcells();        };
+
+  void add(std::string key, S spec)       { specs[key] = spec;                       };
+  std::vector<std::string> getKeys();
+  H* at(std::string);
+  H* prototype(std::string);
+};
+
+template <typename H, typename S>
+std::vector<std::string> lazy_histos<H, S>::getKeys() {
+  std::vector<std::string> keys;
+  for (auto& spec : specs) {
+    keys.push_back(spec.first);
+  }
+  return keys;
+}
+
+// books the histogram on first use, throws std::out_of_range for unknown keys like unordered_map::at
+template <typename H, typename S>
+H* lazy_histos<H, S>::at(std::string key) {
+  auto found = booked.find(key);
+  if (found != booked.end()) {
+    return found->second;
+  }
+  auto dir = gDirectory;
+  auto hist = specs.at(key).book(base);
+  dir->cd();
+  booked[key] = hist;
+  return hist;
+}
+
+// a histogram with the binning of a key that belongs to no directory and is
+// not booked, owned by the caller
+template <typename H, typename S>
+H* lazy_histos<H, S>::prototype(std::string key) {
+  auto dir = gDirectory;
+  auto hist = specs.at(key).book(base);
+  hist->SetDirectory(nullptr);
+  dir->cd();
+  return hist;
+}
+
+typedef lazy_histos<TH1F, spec_1d> lazy_histos_1d;
+typedef lazy_histos<TH2F, spec_2d> lazy_histos_2d;
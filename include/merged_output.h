@@ -0,0 +1,312 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <glob.h>
+#include "TH1.h"
+#include "TKey.h"
+#include "TFile.h"
+#include "TList.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To merge the analyzer outputs into one set  //
+// of histograms per process, like hadd, but in memory  //
+// so the post-processing can work on the merged        //
+// histograms before anything is written. The groups    //
+// are read from inputs/merge.txt:                      //
+//   output : merged file, output/<output>.root         //
+//   type   : data, bkg (subtracted from data in the    //
+//            control regions) or sig                   //
+//   inputs : comma-separated file patterns, only      //
+//            files ending in _output.root are merged,  //
+//            any other output is reported as unmatched //
+// Every input file is read exactly once. Histograms    //
+// are added bin by bin through their content and       //
+// sum of weights^2 arrays.                             //
+//////////////////////////////////////////////////////////
+
+// histograms of one directory by name
+typedef std::map<std::string, TH1*> merged_dir;
+
+struct merge_group {
+  std::string name, type;
+  std::vector<std::string> patterns;
+  std::vector<std::string> files;
+  std::map<std::string, merged_dir> dirs;       // by path, "" for the top directory
+};
+
+class merged_output {
+private:
+  bool valid;
+  std::string file_name, input_dir;
+  std::vector<merge_group> groups;
+
+  static std::vector<std::string> split(std::string);
+  void read(TDirectory*, std::string, merge_group&);
+
+public:
+  merged_output (std::string, std::string);
+  virtual ~merged_output () {};
+
+  // getters
+  bool isValid()                          { return valid;  };
+  std::vector<merge_group>& getGroups()   { return groups; };
+
+  static bool sameBinning(TH1*, TH1*);
+  static void addBins(TH1*, TH1*, double);
+  static void scaleBins(TH1*, double);
+
+  merge_group* find(std::string);
+  merge_group* add(std::string, std::string);
+  bool read();
+  void write(std::string);
+};
+
+merged_output::merged_output(std::string fname, std::string dir) :
+  valid(false),
+  file_name(fname),
+  input_dir(dir)
+{
+  std::ifstream table(file_name);
+  if (!table) {
+    std::cerr << "Unable to read merge table " << file_name << std::endl;
+    return;
+  }
+
+  std::string line;
+  int line_number(0);
+  while (std::getline(table, line)) {
+    line_number++;
+    if (line.find('#') != std::string::npos) {
+      line = line.substr(0, line.find('#'));
+    }
+    std::stringstream ss(line);
+    std::string name, type, inputs;
+    if (!(ss >> name)) {
+      continue;
+    }
+    if (!(ss >> type >> inputs) || (type != "data" && type != "bkg" && type != "sig")) {
+      std::cerr << file_name << ":" << line_number << ": expected output, type (data, bkg or sig), inputs" << std::endl;
+      return;
+    }
+    groups.push_back({name, type, split(inputs), {}, {}});
+  }
+  valid = true;
+}
+
+std::vector<std::string> merged_output::split(std::string list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+// nullptr if there is no such group
+merge_group* merged_output::find(std::string name) {
+  for (auto& group : groups) {
+    if (group.name == name) {
+      return &group;
+    }
+  }
+  return nullptr;
+}
+
+// a group made by the post-processing, i.e. the QCD estimate
+merge_group* merged_output::add(std::string name, std::string type) {
+  auto group = find(name);
+  if (!group) {
+    groups.push_back({name, type, {}, {}, {}});
+    group = &groups.back();
+  }
+  return group;
+}
+
+bool merged_output::sameBinning(TH1* first, TH1* second) {
+  return first->GetDimension() == second->GetDimension() && first->GetNcells() == second->GetNcells() &&
+         first->GetNbinsX() == second->GetNbinsX();
+}
+
+// target += factor * other. Histograms of the same type are added through
+// their arrays, which the compiler vectorizes, anything else through TH1::Add
+void merged_output::addBins(TH1* target, TH1* other, double factor) {
+  if (!sameBinning(target, other)) {
+    std::cerr << "Can't add " << other->GetName() << " to " << target->GetName() << " with different binning" << std::endl;
+    return;
+  }
+  int ncells = target->GetNcells();
+  auto target_f = dynamic_cast<TArrayF*>(target);
+  auto other_f = dynamic_cast<TArrayF*>(other);
+  auto target_d = dynamic_cast<TArrayD*>(target);
+  auto other_d = dynamic_cast<TArrayD*>(other);
+  if (!(target_f && other_f) && !(target_d && other_d)) {
+    target->Add(other, factor);
+    return;
+  }
+
+  // unweighted histograms have sumw2 = contents, which has to be kept once one side is weighted
+  if (target->GetSumw2N() == 0 && (other->GetSumw2N() > 0 || factor != 1.)) {
+    target->Sumw2();
+  }
+  double entries = target->GetEntries() + other->GetEntries();
+  if (target->GetSumw2N() > 0) {
+    double *sumw2 = target->GetSumw2()->fArray;
+    double factor2 = factor * factor;
+    if (other->GetSumw2N() > 0) {
+      const double *other_sumw2 = other->GetSumw2()->fArray;
+      for (int bin = 0; bin < ncells; bin++) {
+        sumw2[bin] += factor2 * other_sumw2[bin];
+      }
+    } else if (other_f) {
+      const Float_t *contents = other_f->fArray;
+      for (int bin = 0; bin < ncells; bin++) {
+        sumw2[bin] += factor2 * contents[bin];
+      }
+    } else {
+      const double *contents = other_d->fArray;
+      for (int bin = 0; bin < ncells; bin++) {
+        sumw2[bin] += factor2 * contents[bin];
+      }
+    }
+  }
+  if (target_f) {
+    Float_t *contents = target_f->fArray;
+    const Float_t *other_contents = other_f->fArray;
+    for (int bin = 0; bin < ncells; bin++) {
+      contents[bin] += factor * other_contents[bin];
+    }
+  } else {
+    double *contents = target_d->fArray;
+    const double *other_contents = other_d->fArray;
+    for (int bin = 0; bin < ncells; bin++) {
+      contents[bin] += factor * other_contents[bin];
+    }
+  }
+  target->ResetStats();
+  target->SetEntries(entries);
+}
+
+void merged_output::scaleBins(TH1* hist, double factor) {
+  if (hist->GetSumw2N() == 0) {
+    hist->Sumw2();
+  }
+  double entries = hist->GetEntries();
+  hist->Scale(factor);
+  hist->SetEntries(entries);
+}
+
+// add every histogram below dir to the group, taking the ones seen first
+void merged_output::read(TDirectory* dir, std::string path, merge_group& group) {
+  TIter next(dir->GetListOfKeys());
+  TKey *key;
+  while ((key = (TKey*)next())) {
+    auto obj = key->ReadObj();
+    auto subdir = dynamic_cast<TDirectory*>(obj);
+    if (subdir) {
+      read(subdir, path.empty() ? subdir->GetName() : path + "/" + subdir->GetName(), group);
+      continue;
+    }
+    auto hist = dynamic_cast<TH1*>(obj);
+    if (!hist) {
+      delete obj;
+      continue;
+    }
+    auto& histos = group.dirs[path];
+    auto found = histos.find(hist->GetName());
+    if (found == histos.end()) {
+      hist->SetDirectory(nullptr);
+      histos[hist->GetName()] = hist;
+    } else {
+      addBins(found->second, hist, 1.);
+      delete hist;
+    }
+  }
+}
+
+// find the inputs of every group and merge them
+bool merged_output::read() {
+  std::map<std::string, std::string> owner;
+  for (auto& group : groups) {
+    for (auto& pattern : group.patterns) {
+      glob_t found;
+      if (glob((input_dir + pattern).c_str(), 0, nullptr, &found) == 0) {
+        for (size_t i = 0; i < found.gl_pathc; i++) {
+          std::string path(found.gl_pathv[i]);
+          if (path.size() < 12 || path.compare(path.size() - 12, 12, "_output.root") != 0) {
+            continue;
+          }
+          if (owner.find(path) != owner.end()) {
+            if (owner[path] != group.name) {
+              std::cerr << path << " matches both " << owner[path] << " and " << group.name << " in " << file_name << std::endl;
+              globfree(&found);
+              return false;
+            }
+            continue;
+          }
+          owner[path] = group.name;
+          group.files.push_back(path);
+        }
+      }
+      globfree(&found);
+    }
+  }
+
+  // outputs in no group would be silently left out of every merged file
+  glob_t all;
+  if (glob((input_dir + "*_output.root").c_str(), 0, nullptr, &all) == 0) {
+    for (size_t i = 0; i < all.gl_pathc; i++) {
+      if (owner.find(all.gl_pathv[i]) == owner.end()) {
+        std::cerr << "Warning: " << all.gl_pathv[i] << " matches no group in " << file_name << ", not merged" << std::endl;
+      }
+    }
+  }
+  globfree(&all);
+
+  for (auto& group : groups) {
+    for (auto& path : group.files) {
+      auto fin = TFile::Open(path.c_str(), "READ");
+      if (!fin || fin->IsZombie()) {
+        std::cerr << "Unable to read " << path << std::endl;
+        return false;
+      }
+      read(fin, "", group);
+      fin->Close();
+      delete fin;
+    }
+    size_t nhistos(0);
+    for (auto& dir : group.dirs) {
+      nhistos += dir.second.size();
+    }
+    std::cout << "Merged " << group.files.size() << " files into " << group.name << " (" << nhistos << " histograms)" << std::endl;
+  }
+  return true;
+}
+
+// one file per group with at least one histogram, output/<group>.root
+void merged_output::write(std::string output_dir) {
+  for (auto& group : groups) {
+    if (group.dirs.empty()) {
+      continue;
+    }
+    auto fout = new TFile((output_dir + group.name + ".root").c_str(), "RECREATE");
+    for (auto& dir : group.dirs) {
+      TDirectory *target = fout;
+      if (!dir.first.empty()) {
+        target = fout->GetDirectory(dir.first.c_str());
+        if (!target) {
+          target = fout->mkdir(dir.first.c_str());
+        }
+      }
+      for (auto& hist : dir.second) {
+        target->WriteTObject(hist.second);
+      }
+    }
+    fout->Close();
+    delete fout;
+  }
+}
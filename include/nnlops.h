@@ -0,0 +1,114 @@
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include "TFile.h"
+#include "TGraph.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To reweight the ggH samples from POWHEG to  //
+// the NNLOPS Higgs pT spectrum. The four graphs of     //
+// inputs/NNLOPS_reweight.root (0, 1, 2 and >= 3 gen    //
+// jets) are sampled once on a uniform pT grid, and the //
+// weight is interpolated linearly between the two grid //
+// points around the Higgs pT, so a lookup is one       //
+// multiplication and no search. The pT is capped at    //
+// the end of each graph's validity as in the reference //
+// implementation (125, 625, 800 and 925 GeV). With     //
+// check(), the table is compared to TGraph::Eval, the  //
+// graphs are only kept for that.                       //
+//   --nnlops-check : print the largest difference      //
+//                    between the table and the graphs  //
+//////////////////////////////////////////////////////////
+class nnlops {
+private:
+  static const int n_tables = 4;
+
+  bool valid;
+  double step, inverse_step;
+  std::vector<double> max_pt;
+  std::vector<std::vector<double>> tables;      // weight at i * step, by jet bin
+  std::vector<TGraph*> graphs;
+
+  static int getTable(int njets)        { return njets < 0 ? 0 : njets >= n_tables ? n_tables - 1 : njets; };
+
+public:
+  nnlops (std::string, double, bool);
+  virtual ~nnlops () {};
+
+  // getters
+  bool isValid()        { return valid; };
+
+  double weight(int njets, double pt) const {
+    int table = getTable(njets);
+    pt = pt < 0. ? 0. : pt > max_pt[table] ? max_pt[table] : pt;
+    double position = pt * inverse_step;
+    int i = int(position);
+    const double *values = &tables[table][i];
+    return values[0] + (position - i) * (values[1] - values[0]);
+  }
+
+  double check(int);
+};
+
+// the graphs are kept only if they will be checked
+nnlops::nnlops(std::string fname, double grid_step, bool keep_graphs) :
+  valid(false),
+  step(grid_step),
+  inverse_step(1. / grid_step),
+  max_pt({125., 625., 800., 925.})
+{
+  auto dir = gDirectory;
+  auto fin = TFile::Open(fname.c_str(), "READ");
+  if (!fin || fin->IsZombie()) {
+    std::cerr << "Unable to read the NNLOPS weights from " << fname << std::endl;
+    dir->cd();
+    return;
+  }
+
+  for (int table = 0; table < n_tables; table++) {
+    std::string name = "gr_NNLOPSratio_pt_powheg_" + std::to_string(table) + "jet";
+    auto graph = (TGraph*)fin->Get(name.c_str());
+    if (!graph) {
+      std::cerr << "No " << name << " in " << fname << std::endl;
+      fin->Close();
+      dir->cd();
+      return;
+    }
+
+    // one point past the cap, so the point above the pT always exists
+    int npoints = int(std::ceil(max_pt[table] * inverse_step)) + 2;
+    std::vector<double> values(npoints);
+    for (int i = 0; i < npoints; i++) {
+      values[i] = graph->Eval(i * step);
+    }
+    tables.push_back(values);
+    if (keep_graphs) {
+      graphs.push_back((TGraph*)graph->Clone());
+    }
+  }
+  fin->Close();
+  dir->cd();
+  valid = true;
+}
+
+// largest absolute difference to TGraph::Eval over n pT values per table
+double nnlops::check(int n) {
+  if (graphs.empty()) {
+    return 0.;
+  }
+  double largest(0.);
+  for (int table = 0; table < n_tables; table++) {
+    double table_largest(0.);
+    for (int i = 0; i <= n; i++) {
+      double pt = max_pt[table] * i / n;
+      table_largest = std::max(table_largest, std::fabs(weight(table, pt) - graphs[table]->Eval(pt)));
+    }
+    std::cout << "NNLOPS " << table << (table == n_tables - 1 ? "+" : "") << " jets: largest difference to TGraph::Eval "
+              << table_largest << std::endl;
+    largest = std::max(largest, table_largest);
+  }
+  return largest;
+}
@@ -0,0 +1,181 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include "TROOT.h"
+#include "TFile.h"
+#include "TList.h"
+#include "TMemFile.h"
+#include "TDirectory.h"
+#include "RVersion.h"
+#include "ROOT/TBufferMerger.hxx"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 22, 0)
+typedef ROOT::TBufferMerger buffer_merger;
+#else
+typedef ROOT::Experimental::TBufferMerger buffer_merger;
+#endif
+
+//////////////////////////////////////////////////////////
+// Purpose: To write the output file, optionally        //
+// serializing and compressing its directories on       //
+// several threads. In that case the histograms are     //
+// booked in a TMemFile, and start() hands groups of    //
+// directories to worker threads that each write them   //
+// into their own TBufferMerger file, while a           //
+// TBufferMerger thread appends the compressed buffers  //
+// to the output. start() returns right away, so the    //
+// rest of the job runs while the output is written,    //
+// and close() waits for it.                            //
+//   --write-threads N   : threads serializing the      //
+//                         output (0 = write at close)  //
+//   --compression A:L   : algorithm and level, i.e.    //
+//                         lz4:4 for intermediate and   //
+//                         zstd:5 or lzma:9 for final   //
+//                         outputs. zlib:1 otherwise    //
+//////////////////////////////////////////////////////////
+class output_writer {
+private:
+  bool valid;
+  std::string file_name;
+  int nthreads, compression;
+  TFile *fout;
+  std::unique_ptr<buffer_merger> merger;
+  std::vector<std::thread> workers;
+
+  void collect(TDirectory*, std::string, std::vector<std::pair<std::string, TObject*>>&);
+
+public:
+  output_writer (CLParser&, std::string);
+  virtual ~output_writer () {};
+
+  static bool readCompression(std::string, int&);
+
+  // getters
+  bool isValid()        { return valid; };
+
+  TFile* open();
+  void start();
+  void close();
+};
+
+output_writer::output_writer(CLParser& parser, std::string fname) :
+  valid(true),
+  file_name(fname),
+  nthreads(0),
+  compression(101),
+  fout(nullptr)
+{
+  std::string threads = parser.Option("--write-threads");
+  if (!threads.empty()) {
+    nthreads = std::stoi(threads);
+  }
+  valid = readCompression(parser.Option("--compression"), compression);
+  if (nthreads > 0) {
+    ROOT::EnableThreadSafety();
+  }
+}
+
+// ROOT compression settings 100 * algorithm + level
+bool output_writer::readCompression(std::string setting, int& value) {
+  if (setting.empty()) {
+    return true;
+  }
+  std::string algorithm = setting.substr(0, setting.find(':'));
+  int level = setting.find(':') == std::string::npos ? 1 : std::stoi(setting.substr(setting.find(':') + 1));
+  std::vector<std::string> algorithms = {"", "zlib", "lzma", "old", "lz4", "zstd"};
+  for (size_t i = 1; i < algorithms.size(); i++) {
+    if (algorithm == algorithms.at(i) && level >= 0 && level <= 9) {
+      value = 100 * i + level;
+      return true;
+    }
+  }
+  std::cerr << "Unknown compression " << setting << ", use zlib, lzma, lz4 or zstd with a level 0-9, i.e. lz4:4" << std::endl;
+  return false;
+}
+
+// the file to book the histograms in
+TFile* output_writer::open() {
+  if (nthreads > 0) {
+    fout = new TMemFile(file_name.c_str(), "RECREATE");
+  } else {
+    fout = new TFile(file_name.c_str(), "RECREATE");
+    fout->SetCompressionSettings(compression);
+  }
+  return fout;
+}
+
+// every object in memory below dir, with the path of its directory
+void output_writer::collect(TDirectory* dir, std::string path, std::vector<std::pair<std::string, TObject*>>& objects) {
+  auto list = dir->GetList();
+  for (int i = 0; i < list->GetSize(); i++) {
+    auto obj = list->At(i);
+    auto subdir = dynamic_cast<TDirectory*>(obj);
+    if (subdir) {
+      collect(subdir, path.empty() ? subdir->GetName() : path + "/" + subdir->GetName(), objects);
+    } else {
+      objects.push_back({path, obj});
+    }
+  }
+}
+
+// begin writing, all histograms must be filled
+void output_writer::start() {
+  if (nthreads <= 0) {
+    return;
+  }
+  std::vector<std::pair<std::string, TObject*>> objects;
+  collect(fout, "", objects);
+
+  // split by directory, so every directory is written by one thread
+  std::vector<std::vector<std::pair<std::string, TObject*>>> groups(nthreads);
+  std::vector<std::string> paths;
+  for (auto& object : objects) {
+    auto found = std::find(paths.begin(), paths.end(), object.first);
+    if (found == paths.end()) {
+      found = paths.insert(paths.end(), object.first);
+    }
+    groups.at((found - paths.begin()) % nthreads).push_back(object);
+  }
+
+  merger.reset(new buffer_merger(file_name.c_str(), "RECREATE", compression));
+  for (auto& group : groups) {
+    if (group.empty()) {
+      continue;
+    }
+    auto file = merger->GetFile();
+    workers.emplace_back([file, group]() {
+      for (auto& object : group) {
+        TDirectory *dir = file.get();
+        if (!object.first.empty()) {
+          dir = file->GetDirectory(object.first.c_str());
+          if (!dir) {
+            dir = file->mkdir(object.first.c_str());
+          }
+        }
+        dir->WriteTObject(object.second);
+      }
+      file->Write();
+    });
+  }
+  std::cout << "Writing " << objects.size() << " objects in " << paths.size() << " directories on " << workers.size() << " threads" << std::endl;
+}
+
+// wait until everything is on disk
+void output_writer::close() {
+  if (nthreads <= 0) {
+    fout->cd();
+    fout->Write();
+    fout->Close();
+    return;
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+  merger.reset();
+  fout->Close();
+}
@@ -0,0 +1,166 @@
+#include <set>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "TH1.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To estimate the QCD background from the     //
+// merged histograms, for every channel, category and   //
+// systematic at once. For each <ch>_antiiso_<cat>_cr   //
+// directory of the data, the shape is the data minus   //
+// all bkg groups in the opposite-sign anti-isolated    //
+// region, normalized to the same subtraction in the    //
+// same-sign region (_crSS). The result is written as   //
+// QCD<suffix> in <ch>_<cat> of the QCD group. A        //
+// systematic missing for data or a background uses its //
+// nominal histogram.                                   //
+//////////////////////////////////////////////////////////
+class qcd_estimate {
+private:
+  merged_output *merged;
+  std::string data_name, output_name;
+
+  static std::string getSuffix(std::string, merged_dir&);
+  static TH1* getShifted(merged_dir&, std::string, std::string);
+  TH1* subtract(std::string, std::string, std::string);
+
+public:
+  qcd_estimate (merged_output*, std::string, std::string);
+  virtual ~qcd_estimate () {};
+
+  int estimate();
+};
+
+qcd_estimate::qcd_estimate(merged_output* m, std::string data, std::string output) :
+  merged(m),
+  data_name(data),
+  output_name(output)
+  {}
+
+// the systematic of a histogram: what follows the shortest name, ending
+// before a '_', that is also a histogram of the directory. Empty if nominal
+std::string qcd_estimate::getSuffix(std::string name, merged_dir& histos) {
+  for (size_t pos = name.find('_'); pos != std::string::npos; pos = name.find('_', pos + 1)) {
+    if (histos.find(name.substr(0, pos)) != histos.end()) {
+      return name.substr(pos);
+    }
+  }
+  return "";
+}
+
+// the shifted histogram of a process, or its nominal
+TH1* qcd_estimate::getShifted(merged_dir& histos, std::string process, std::string suffix) {
+  auto found = histos.find(process + suffix);
+  if (found == histos.end()) {
+    found = histos.find(process);
+  }
+  return found == histos.end() ? nullptr : found->second;
+}
+
+// data minus all backgrounds in a directory, nullptr without data
+TH1* qcd_estimate::subtract(std::string dir, std::string data_process, std::string suffix) {
+  auto data = merged->find(data_name);
+  auto data_hist = getShifted(data->dirs[dir], data_process, suffix);
+  if (!data_hist) {
+    return nullptr;
+  }
+  auto result = (TH1*)data_hist->Clone();
+  result->SetDirectory(nullptr);
+  for (auto& group : merged->getGroups()) {
+    if (group.type != "bkg" || group.name == output_name) {
+      continue;
+    }
+    auto found = group.dirs.find(dir);
+    if (found == group.dirs.end()) {
+      continue;
+    }
+    for (auto& hist : found->second) {
+      if (getSuffix(hist.first, found->second).empty()) {
+        auto shifted = getShifted(found->second, hist.first, suffix);
+        if (merged_output::sameBinning(result, shifted)) {
+          merged_output::addBins(result, shifted, -1.);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+// number of QCD histograms made
+int qcd_estimate::estimate() {
+  // added first, adding a group moves the others
+  auto output = merged->add(output_name, "bkg");
+  auto data = merged->find(data_name);
+  if (!data) {
+    std::cerr << "No " << data_name << " group to estimate QCD from" << std::endl;
+    return 0;
+  }
+
+  int nmade(0);
+  std::vector<std::string> regions;
+  for (auto& dir : data->dirs) {
+    regions.push_back(dir.first);
+  }
+  for (auto& region : regions) {
+    // <ch>_antiiso_<cat>_cr
+    auto antiiso = region.find("_antiiso_");
+    if (antiiso == std::string::npos || region.size() < 3 || region.compare(region.size() - 3, 3, "_cr") != 0) {
+      continue;
+    }
+    std::string same_sign = region + "SS";
+    std::string category = region.substr(0, antiiso) + "_" + region.substr(antiiso + 9, region.size() - 3 - antiiso - 9);
+    if (data->dirs.find(same_sign) == data->dirs.end()) {
+      std::cerr << "No " << same_sign << " for the QCD estimate in " << category << std::endl;
+      continue;
+    }
+
+    // the systematics of everything subtracted in the region
+    std::set<std::string> suffixes = {""};
+    std::string data_process;
+    for (auto& group : merged->getGroups()) {
+      if (group.type == "sig" || group.name == output_name) {
+        continue;
+      }
+      for (auto dir : {region, same_sign}) {
+        auto found = group.dirs.find(dir);
+        if (found == group.dirs.end()) {
+          continue;
+        }
+        for (auto& hist : found->second) {
+          auto suffix = getSuffix(hist.first, found->second);
+          auto nominal = found->second.at(hist.first.substr(0, hist.first.size() - suffix.size()));
+          if (merged_output::sameBinning(hist.second, nominal)) {
+            suffixes.insert(suffix);
+          }
+          if (&group == data && suffix.empty()) {
+            data_process = hist.first;
+          }
+        }
+      }
+    }
+
+    for (auto& suffix : suffixes) {
+      auto shape = subtract(region, data_process, suffix);
+      auto norm = subtract(same_sign, data_process, suffix);
+      if (!shape || !norm) {
+        delete shape;
+        delete norm;
+        continue;
+      }
+      double integral = shape->Integral();
+      merged_output::scaleBins(shape, integral > 0 ? norm->Integral() / integral : 0.);
+      shape->SetName(("QCD" + suffix).c_str());
+      auto& histos = output->dirs[category];
+      auto found = histos.find(shape->GetName());
+      if (found != histos.end()) {
+        delete found->second;
+      }
+      histos[shape->GetName()] = shape;
+      delete norm;
+      nmade++;
+    }
+  }
+  std::cout << "Estimated QCD in " << nmade << " histograms" << std::endl;
+  return nmade;
+}
@@ -0,0 +1,195 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+
+//////////////////////////////////////////////////////////
+// Purpose: To hold what is known about each input      //
+// sample, read once from inputs/samples.txt, which is  //
+// also read by automate_analysis.py. For each sample:  //
+//   type          : data or mc                         //
+//   cross section : in pb, may be a product, i.e.      //
+//                   44.14*0.0627                       //
+//   events        : generated events, "-" to use the   //
+//                   "nevents" histogram of the file    //
+//   stitch        : group:jets, i.e. WJets:2 for the   //
+//                   2-jet W sample, "-" if unstitched  //
+//   processes     : comma-separated -n values to run   //
+//////////////////////////////////////////////////////////
+struct sample_info {
+  std::string name;
+  bool isData;
+  double xs;
+  double nevents;                       // 0 if not in the table
+  std::string group;                    // empty if not stitched
+  int jets;                             // generated jets of an exclusive sample, 0 if inclusive
+  std::vector<std::string> processes;
+};
+
+class sample_table {
+private:
+  bool valid;
+  std::string file_name;
+  std::unordered_map<std::string, sample_info> samples;
+  std::unordered_map<std::string, std::vector<std::string>> groups;  // members by number of jets
+
+  static double readNumber(std::string);
+  static std::vector<std::string> split(std::string);
+
+public:
+  sample_table (std::string);
+  virtual ~sample_table () {};
+
+  // inputs/samples.txt, loaded the first time it is used
+  static sample_table& get();
+
+  // getters
+  bool isValid()                          { return valid;                                 };
+  bool has(std::string sample)            { return samples.find(sample) != samples.end(); };
+
+  const sample_info* find(std::string);
+  double getCrossSection(std::string);
+  std::vector<std::string> getGroup(std::string);
+  bool isData(std::string);
+  bool check(std::string, std::string);
+};
+
+sample_table::sample_table(std::string fname) :
+  valid(false),
+  file_name(fname)
+{
+  std::ifstream table(file_name);
+  if (!table) {
+    std::cerr << "Unable to read sample table " << file_name << std::endl;
+    return;
+  }
+
+  std::string line;
+  int line_number(0);
+  while (std::getline(table, line)) {
+    line_number++;
+    if (line.find('#') != std::string::npos) {
+      line = line.substr(0, line.find('#'));
+    }
+    std::stringstream ss(line);
+    std::string name, type, xs, events, stitch, processes;
+    if (!(ss >> name)) {
+      continue;
+    }
+    if (!(ss >> type >> xs >> events >> stitch >> processes) || (type != "data" && type != "mc")) {
+      std::cerr << file_name << ":" << line_number << ": expected sample, type, cross section, events, stitch, processes" << std::endl;
+      return;
+    }
+
+    sample_info info {name, type == "data", readNumber(xs), events == "-" ? 0. : readNumber(events), "", 0, split(processes)};
+    if (stitch != "-") {
+      auto colon = stitch.find(':');
+      info.group = stitch.substr(0, colon);
+      info.jets = colon == std::string::npos ? 0 : std::stoi(stitch.substr(colon + 1));
+      auto& members = groups[info.group];
+      if (members.size() <= static_cast<size_t>(info.jets)) {
+        members.resize(info.jets + 1);
+      }
+      members.at(info.jets) = name;
+    }
+    samples[name] = info;
+  }
+  valid = true;
+}
+
+sample_table& sample_table::get() {
+  static sample_table table("inputs/samples.txt");
+  return table;
+}
+
+// a number or a product/quotient of numbers, i.e. 3.782*0.0627
+double sample_table::readNumber(std::string text) {
+  double value(1.);
+  char op('*');
+  size_t start(0);
+  while (start <= text.size()) {
+    size_t end = text.find_first_of("*/", start);
+    double number = std::stod(text.substr(start, end - start));
+    value = op == '*' ? value * number : value / number;
+    if (end == std::string::npos) {
+      break;
+    }
+    op = text[end];
+    start = end + 1;
+  }
+  return value;
+}
+
+std::vector<std::string> sample_table::split(std::string list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+// nullptr if the sample is not in the table
+const sample_info* sample_table::find(std::string sample) {
+  auto found = samples.find(sample);
+  if (found == samples.end()) {
+    return nullptr;
+  }
+  return &found->second;
+}
+
+double sample_table::getCrossSection(std::string sample) {
+  auto info = find(sample);
+  return info ? info->xs : 0.;
+}
+
+// samples of a stitching group, indexed by number of jets (inclusive first)
+std::vector<std::string> sample_table::getGroup(std::string group) {
+  auto found = groups.find(group);
+  if (found == groups.end()) {
+    return {};
+  }
+  return found->second;
+}
+
+// true if all samples in the comma-separated list are data
+bool sample_table::isData(std::string sample_list) {
+  for (auto& sample : split(sample_list)) {
+    auto info = find(sample);
+    if (!info || !info->isData) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// every sample is in the table and they are all data or all MC. Also warns if
+// the process is not one the table lists for the samples
+bool sample_table::check(std::string sample_list, std::string process) {
+  if (!valid) {
+    return false;
+  }
+  auto list = split(sample_list);
+  for (auto& sample : list) {
+    auto info = find(sample);
+    if (!info) {
+      std::cerr << "Sample " << sample << " is not in " << file_name << std::endl;
+      return false;
+    }
+    if (info->isData != find(list.front())->isData) {
+      std::cerr << "Can't mix data and MC samples in one job: " << sample_list << std::endl;
+      return false;
+    }
+    bool listed(false);
+    for (auto& name : info->processes) {
+      listed = listed || name == process;
+    }
+    if (!listed) {
+      std::cout << "Warning: process " << process << " is not listed for " << sample << " in " << file_name << std::endl;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,203 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "TH1.h"
+#include "TArrayD.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To fill one histogram from several threads  //
+// without a copy per thread. Bins are found with the   //
+// fast_axis of fast_hist.h and filled in one of two    //
+// ways:                                                //
+//   atomic : one shared array, bins are updated with a //
+//            relaxed compare-and-swap on the double    //
+//   local  : every slot (thread) fills its own array,  //
+//            summed by flush()                         //
+//   auto   : local if all copies together are small,   //
+//            atomic if they would not fit the budget,  //
+//            otherwise atomic until a slot sees more   //
+//            than 1% of its updates retried, then that //
+//            slot switches to its own copy             //
+// Both arrays can be in use at once, flush() adds them //
+// all to the ROOT histogram the object was made from.  //
+// hist_benchmark.cc measures the modes against each    //
+// other for different sizes and thread counts.         //
+//////////////////////////////////////////////////////////
+class shared_hist {
+public:
+  enum fill_mode { atomic, local, automatic };
+
+  static const size_t small_bytes = 256 << 10;    // always local below this, all slots together
+  static const size_t budget_bytes = 16 << 20;    // never local above this
+  static const Long64_t check_every = 4096;       // fills of a slot between contention checks
+
+  static bool readMode(std::string, fill_mode&);
+
+private:
+  struct alignas(64) slot_state {
+    bool local;
+    Long64_t fills, retries, entries;
+    std::vector<double> contents, sumw2;          // empty until the slot goes local
+  };
+
+  TH1 *target;
+  fast_axis xaxis, yaxis;
+  int dimension, nx;
+  size_t ncells;
+  fill_mode mode;
+  std::unique_ptr<std::atomic<double>[]> contents, sumw2;
+  std::vector<slot_state> slots;
+
+  static void add(std::atomic<double>& value, double weight, Long64_t& retries) {
+    double old = value.load(std::memory_order_relaxed);
+    while (!value.compare_exchange_weak(old, old + weight, std::memory_order_relaxed)) {
+      retries++;
+    }
+  }
+
+  void goLocal(slot_state&);
+
+public:
+  shared_hist (TH1*, unsigned, fill_mode);
+  virtual ~shared_hist () {};
+
+  // getters
+  TH1* getTarget()      { return target;       };
+  fill_mode getMode()   { return mode;         };
+  size_t getNSlots()    { return slots.size(); };
+
+  Int_t findBin(double x, double y) const {
+    return dimension == 1 ? xaxis.find(x) : xaxis.find(x) + (nx + 2) * yaxis.find(y);
+  }
+
+  // only called by one thread at a time for a given slot
+  void fill(unsigned slot, double x, double y, double weight) {
+    Int_t bin = findBin(x, y);
+    auto& state = slots[slot];
+    state.entries++;
+    if (state.local) {
+      state.contents[bin] += weight;
+      state.sumw2[bin] += weight * weight;
+      return;
+    }
+    add(contents[bin], weight, state.retries);
+    add(sumw2[bin], weight * weight, state.retries);
+    if (mode == automatic && ++state.fills == check_every) {
+      if (state.retries * 100 > 2 * check_every) {
+        goLocal(state);
+      }
+      state.fills = 0;
+      state.retries = 0;
+    }
+  }
+
+  size_t getBytes();
+  int getNLocal();
+  void flush();
+};
+
+// "atomic", "local" or "auto" (also the default when empty)
+bool shared_hist::readMode(std::string name, fill_mode& mode) {
+  if (name == "atomic") {
+    mode = atomic;
+  } else if (name == "local") {
+    mode = local;
+  } else if (name == "auto" || name.empty()) {
+    mode = automatic;
+  } else {
+    std::cerr << "Unknown histogram fill mode " << name << ", choose from atomic, local, auto" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+shared_hist::shared_hist(TH1* hist, unsigned nslots, fill_mode requested) :
+  target(hist),
+  xaxis(hist->GetXaxis()),
+  yaxis(hist->GetYaxis()),
+  dimension(hist->GetDimension()),
+  nx(hist->GetNbinsX()),
+  ncells(hist->GetNcells()),
+  mode(requested),
+  contents(new std::atomic<double>[ncells]),
+  sumw2(new std::atomic<double>[ncells]),
+  slots(std::max(nslots, 1u))
+{
+  for (size_t bin = 0; bin < ncells; bin++) {
+    contents[bin] = 0.;
+    sumw2[bin] = 0.;
+  }
+
+  // copies for every slot cost 2 doubles per cell each
+  size_t local_bytes = 2 * sizeof(double) * ncells * slots.size();
+  if (mode == automatic && local_bytes <= small_bytes) {
+    mode = local;
+  } else if (mode == automatic && local_bytes > budget_bytes) {
+    mode = atomic;
+  }
+  for (auto& state : slots) {
+    state.local = false;
+    state.fills = state.retries = state.entries = 0;
+    if (mode == local) {
+      goLocal(state);
+    }
+  }
+}
+
+void shared_hist::goLocal(slot_state& state) {
+  state.contents.assign(ncells, 0.);
+  state.sumw2.assign(ncells, 0.);
+  state.local = true;
+}
+
+// memory used by the bin arrays
+size_t shared_hist::getBytes() {
+  size_t bytes = 2 * sizeof(double) * ncells;
+  for (auto& state : slots) {
+    bytes += sizeof(double) * (state.contents.size() + state.sumw2.size());
+  }
+  return bytes;
+}
+
+int shared_hist::getNLocal() {
+  int nlocal(0);
+  for (auto& state : slots) {
+    nlocal += state.local;
+  }
+  return nlocal;
+}
+
+// add everything filled so far to the ROOT histogram, no fills may be running
+void shared_hist::flush() {
+  Long64_t entries(0);
+  for (auto& state : slots) {
+    entries += state.entries;
+    state.entries = 0;
+  }
+  if (entries == 0) {
+    return;
+  }
+  if (target->GetSumw2N() == 0) {
+    target->Sumw2();
+  }
+  double *target_sumw2 = target->GetSumw2()->fArray;
+  for (size_t bin = 0; bin < ncells; bin++) {
+    double sum = contents[bin].exchange(0.), sum2 = sumw2[bin].exchange(0.);
+    for (auto& state : slots) {
+      if (state.local) {
+        sum += state.contents[bin];
+        sum2 += state.sumw2[bin];
+        state.contents[bin] = state.sumw2[bin] = 0.;
+      }
+    }
+    if (sum != 0. || sum2 != 0.) {
+      target->AddBinContent(bin, sum);
+      target_sumw2[bin] += sum2;
+    }
+  }
+  double total = target->GetEntries() + entries;
+  target->ResetStats();
+  target->SetEntries(total);
+}
@@ -0,0 +1,145 @@
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <sys/stat.h>
+#include "TFile.h"
+#include "TNamed.h"
+#include "TEntryList.h"
+
+////////////////////////////////////////////////////////
+// Purpose: To store the entries passing the event    //
+// selection so that later runs on the same input     //
+// can skip every event that would be thrown away.    //
+// The cache is keyed by the input and the selection  //
+// configuration: every parameter the cuts read, and  //
+// a version bumped when the selection code changes.  //
+////////////////////////////////////////////////////////
+
+// the selection a cache belongs to. add() returns its value, so a cut
+// is declared and made part of the key in one place, i.e.
+// const double tau_pt_min = selection.add("tau_pt_min", 30.);
+class selection_config {
+private:
+  std::stringstream text;
+
+public:
+  selection_config (std::string channel, int version) { text << channel << "_v" << version; };
+  virtual ~selection_config () {};
+
+  // getters
+  std::string getKey()    { return text.str(); };
+
+  template <typename T>
+  T add(std::string name, T value) {
+    text << ":" << name << "=" << value;
+    return value;
+  }
+};
+
+class skim_cache {
+private:
+  bool enabled, valid;
+  std::string key, cache_name;
+  TEntryList *cached;   // entries read from a valid cache
+  TEntryList *passing;  // entries recorded during this run
+
+public:
+  skim_cache (bool, std::string, std::string, std::string, std::string);
+  virtual ~skim_cache () {};
+
+  static ULong64_t hash(std::string);
+  static std::string fileID(TFile*);
+
+  // getters
+  bool isValid()                  { return valid;                              };
+  std::string getName()           { return cache_name;                         };
+  Long64_t getN(Long64_t nevts)   { return valid ? cached->GetN() : nevts;     };
+  Long64_t getEntry(Long64_t i)   { return valid ? cached->GetEntry(i) : i;    };
+
+  void record(Long64_t);
+  void write();
+};
+
+// FNV-1a, enough to tell apart inputs and selections
+ULong64_t skim_cache::hash(std::string str) {
+  ULong64_t h = 14695981039346656037ULL;
+  for (auto c : str) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// identify the input by its UUID, size and modification time
+std::string skim_cache::fileID(TFile* fin) {
+  struct stat info;
+  long mtime = stat(fin->GetName(), &info) == 0 ? info.st_mtime : 0;
+  std::stringstream ss;
+  ss << fin->GetUUID().AsString() << ":" << fin->GetSize() << ":" << mtime;
+  return ss.str();
+}
+
+// look for a cache matching this input and selection
+skim_cache::skim_cache(bool use_cache, std::string channel, std::string sample, std::string input_id, std::string selection) :
+  enabled(use_cache),
+  valid(false),
+  cached(nullptr),
+  passing(nullptr)
+{
+  if (!enabled) {
+    return;
+  }
+
+  key = input_id + "|" + selection;
+  std::stringstream ss;
+  ss << "cache/" << channel << "_" << sample << "_" << std::hex << hash(key) << ".root";
+  cache_name = ss.str();
+
+  auto fcache = TFile::Open(cache_name.c_str(), "READ");
+  if (fcache && !fcache->IsZombie()) {
+    auto stored_key = (TNamed*)fcache->Get("key");
+    auto stored_list = (TEntryList*)fcache->Get("entries");
+    if (stored_key && stored_list && key == stored_key->GetTitle()) {
+      cached = (TEntryList*)stored_list->Clone();
+      cached->SetDirectory(nullptr);
+      valid = true;
+    }
+    fcache->Close();
+  }
+
+  if (valid) {
+    std::cout << "Using skim cache " << cache_name << " (" << cached->GetN() << " entries)" << std::endl;
+  } else {
+    std::cout << "No valid skim cache, will write " << cache_name << std::endl;
+    passing = new TEntryList("entries", selection.c_str());
+    passing->SetDirectory(nullptr);
+  }
+}
+
+// remember an entry that survived the selection
+void skim_cache::record(Long64_t entry) {
+  if (passing) {
+    passing->Enter(entry);
+  }
+}
+
+// write the recorded entries. Write to a temporary file
+// first so an interrupted job never leaves a bad cache
+void skim_cache::write() {
+  if (!passing) {
+    return;
+  }
+
+  mkdir("cache", 0755);
+  std::string tmp_name = cache_name + ".tmp";
+  auto fcache = new TFile(tmp_name.c_str(), "RECREATE");
+  TNamed stored_key("key", key.c_str());
+  stored_key.Write();
+  passing->Write("entries");
+  fcache->Close();
+
+  if (std::rename(tmp_name.c_str(), cache_name.c_str()) != 0) {
+    std::cerr << "Unable to write skim cache " << cache_name << std::endl;
+  }
+}
@@ -0,0 +1,116 @@
+#include <map>
+#include <array>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include "TFile.h"
+#include "TH1D.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To compute the jet-multiplicity stitching   //
+// weights for the inclusive + exclusive W and DY       //
+// samples. An event with n generated jets can come     //
+// from the inclusive sample or from the n-jet sample,  //
+// so it gets weight                                    //
+//   w0 = lumi * xs_incl / N_incl                       //
+//   wn = lumi / (N_incl / xs_incl + N_n / xs_n)        //
+// with N and xs from the sample table (N from the      //
+// "nevents" histogram of each file if the table has    //
+// none). The weights are computed once at startup for  //
+// each group found in the input list and stored in an  //
+// array indexed by the number of jets.                 //
+//////////////////////////////////////////////////////////
+class stitching {
+private:
+  std::map<std::string, std::array<double, 5>> tables;
+
+  static std::string group(std::string);
+  static double readEvents(std::string);
+
+public:
+  stitching (std::vector<std::string>, std::string, std::string, Helper&);
+  virtual ~stitching () {};
+
+  // weight table for this sample, nullptr if it is not stitched
+  const std::array<double, 5>* getTable(std::string);
+
+  // index into the table, 4 holds 4 or more jets
+  static int bin(Float_t n) { return std::min(std::max(static_cast<int>(n), 0), 4); };
+};
+
+// build the table of every group with a sample in the input list
+stitching::stitching(std::vector<std::string> samples, std::string path, std::string postfix, Helper& helper) {
+  for (auto& sample : samples) {
+    std::string name = group(sample);
+    if (name.empty() || tables.find(name) != tables.end()) {
+      continue;
+    }
+
+    // generated events of the inclusive and the four exclusive samples
+    auto members = sample_table::get().getGroup(name);
+    std::array<double, 5> events, xs;
+    bool complete(true);
+    for (size_t n = 0; n < 5 && complete; n++) {
+      auto info = n < members.size() ? sample_table::get().find(members.at(n)) : nullptr;
+      if (!info) {
+        std::cerr << "No " << n << "-jet sample for " << name << " in the sample table, not stitching it" << std::endl;
+        complete = false;
+        break;
+      }
+      events.at(n) = info->nevents > 0. ? info->nevents : readEvents(path + info->name + postfix);
+      xs.at(n) = info->xs;
+      if (events.at(n) <= 0. || xs.at(n) <= 0.) {
+        std::cerr << "Unable to read the number of generated events of " << info->name << ", not stitching " << name << std::endl;
+        complete = false;
+      }
+    }
+    if (!complete) {
+      continue;
+    }
+
+    auto& table = tables[name];
+    table.at(0) = helper.getLuminosity() * xs.at(0) / events.at(0);
+    for (int n = 1; n < 5; n++) {
+      table.at(n) = helper.getLuminosity() / (events.at(0) / xs.at(0) + events.at(n) / xs.at(n));
+    }
+
+    std::cout << "Stitching weights for " << name << std::endl;
+    std::cout << "  jets   generated events   cross section   weight" << std::endl;
+    for (int n = 0; n < 5; n++) {
+      std::cout << "  " << std::setw(4) << n << std::setw(19) << std::setprecision(10) << events.at(n)
+                << std::setw(16) << std::setprecision(6) << xs.at(n) << std::setw(9) << table.at(n) << std::endl;
+    }
+  }
+}
+
+// stitching group of this sample, i.e. "WJets" for "WJets3"
+std::string stitching::group(std::string sample) {
+  auto info = sample_table::get().find(sample);
+  return info ? info->group : "";
+}
+
+// bin 2 of "nevents", 0 if the file can't be read
+double stitching::readEvents(std::string fname) {
+  auto dir = gDirectory;
+  auto fin = TFile::Open(fname.c_str(), "READ");
+  double events(0.);
+  if (fin && !fin->IsZombie()) {
+    auto counts = (TH1D*)fin->Get("nevents");
+    if (counts) {
+      events = counts->GetBinContent(2);
+    }
+    fin->Close();
+  }
+  dir->cd();
+  return events;
+}
+
+const std::array<double, 5>* stitching::getTable(std::string sample) {
+  auto found = tables.find(group(sample));
+  if (found == tables.end()) {
+    return nullptr;
+  }
+  return &found->second;
+}
@@ -0,0 +1,129 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "TEnv.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TTreeCache.h"
+#include "TTreePerfStats.h"
+
+////////////////////////////////////////////////////////
+// Purpose: To tune how the input tree is read        //
+//   --cache-size MB     : TTreeCache size            //
+//   --learn-entries N   : let ROOT learn the branch  //
+//                         set instead of adding the  //
+//                         bound branches explicitly  //
+//   --read-ahead KB     : read-ahead buffer size     //
+//   --prefetch          : asynchronous prefetching   //
+//   --io-stats          : print I/O statistics       //
+// configure() must be called before opening the file //
+// and setup() after the factories bound branches.    //
+////////////////////////////////////////////////////////
+class tree_io {
+private:
+  TTree *tree;
+  TTreePerfStats *perf;
+  Long64_t cache_size;
+  int learn_entries;
+  bool stats;
+
+public:
+  tree_io (TTree*, CLParser&);
+  virtual ~tree_io () {};
+
+  static void configure(CLParser&);
+  static std::vector<TBranch*> activeBranches(TTree*);
+
+  void setup(Long64_t, Long64_t);
+  void report();
+};
+
+// settings that only take effect for files opened afterwards
+void tree_io::configure(CLParser& parser) {
+  if (parser.Flag("--prefetch")) {
+    gEnv->SetValue("TFile.AsyncPrefetching", 1);
+  }
+  std::string read_ahead = parser.Option("--read-ahead");
+  if (!read_ahead.empty()) {
+    TFile::SetReadaheadSize(std::stoi(read_ahead) * 1024);
+  }
+}
+
+// branches the factories bound with SetBranchAddress
+std::vector<TBranch*> tree_io::activeBranches(TTree* input) {
+  std::vector<TBranch*> active;
+  auto branches = input->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); i++) {
+    auto branch = (TBranch*)branches->At(i);
+    if (branch->GetAddress() != nullptr) {
+      active.push_back(branch);
+    }
+  }
+  return active;
+}
+
+tree_io::tree_io(TTree* input, CLParser& parser) :
+  tree(input),
+  perf(nullptr),
+  cache_size(30),
+  learn_entries(0),
+  stats(parser.Flag("--io-stats"))
+{
+  std::string size = parser.Option("--cache-size");
+  std::string learn = parser.Option("--learn-entries");
+  if (!size.empty()) {
+    cache_size = std::stoll(size);
+  }
+  if (!learn.empty()) {
+    learn_entries = std::stoi(learn);
+  }
+}
+
+// only read the bound branches and cache them for entries [first, last)
+void tree_io::setup(Long64_t first, Long64_t last) {
+  auto active = activeBranches(tree);
+  tree->SetBranchStatus("*", 0);
+  for (auto branch : active) {
+    tree->SetBranchStatus(branch->GetName(), 1);
+  }
+
+  tree->SetCacheSize(cache_size * 1024 * 1024);
+  if (last > first) {
+    tree->SetCacheEntryRange(first, last);
+  }
+  if (learn_entries > 0) {
+    tree->SetCacheLearnEntries(learn_entries);
+  } else {
+    for (auto branch : active) {
+      tree->AddBranchToCache(branch, false);
+    }
+    tree->StopCacheLearningPhase();
+  }
+
+  if (stats) {
+    perf = new TTreePerfStats("ioperf", tree);
+  }
+  std::cout << "Reading " << active.size() << " branches with a " << cache_size << " MB cache" << std::endl;
+}
+
+// summary of the reads done for this job
+void tree_io::report() {
+  if (!perf) {
+    return;
+  }
+  perf->Finish();
+  auto fin = tree->GetCurrentFile();
+  auto cache = dynamic_cast<TTreeCache*>(fin->GetCacheRead(tree));
+
+  std::cout << "I/O report:" << std::endl;
+  std::cout << "  bytes read:       " << perf->GetBytesRead() << std::endl;
+  std::cout << "  read calls:       " << perf->GetReadCalls() << std::endl;
+  std::cout << "  real time (s):    " << perf->GetRealTime() << std::endl;
+  std::cout << "  cpu time (s):     " << perf->GetCpuTime() << std::endl;
+  std::cout << "  unzip time (s):   " << perf->GetUnzipTime() << std::endl;
+  if (cache) {
+    std::cout << "  cache efficiency: " << cache->GetEfficiency() << std::endl;
+    std::cout << "  cache eff. (rel): " << cache->GetEfficiencyRel() << std::endl;
+  }
+}
@@ -3,18 +3,99 @@
 class Helper {
   private:
   double luminosity;
-  std::map<std::string, double> cross_sections;
-  std::unordered_map<std::string, TH1F *> histos_1d;
-  std::unordered_map<std::string, TH2F *> histos_2d;
+  lazy_histos_1d histos_1d;
+  lazy_histos_2d histos_2d;
+  std::unordered_map<std::string, fast_hist> fast_1d, fast_2d;
   std::map<std::string, std::string> systematics;
+  weight_table *recorder;
+  weight_variations *variations;
+  bootstrap *replicas;
 
 public:
   Helper(TFile*,std::string,std::string);
   ~Helper(){};
-  double getCrossSection(std::string sample) { return cross_sections[sample]; };
+  double getCrossSection(std::string sample) { return sample_table::get().getCrossSection(sample); };
   double getLuminosity() { return luminosity; };
-  std::unordered_map<std::string, TH1F *> *getHistos1D() { return &histos_1d; };
-  std::unordered_map<std::string, TH2F *> *getHistos2D() { return &histos_2d; };
+  lazy_histos_1d *getHistos1D() { return &histos_1d; };
+  lazy_histos_2d *getHistos2D() { return &histos_2d; };
+  void setRecorder(weight_table *weights) { recorder = weights; };
+  void setVariations(weight_variations *vars) { variations = vars; };
+  void setReplicas(bootstrap *boot) { replicas = boot; };
+
+  // histograms with this many bins (Q2V1, Q2V2) are mostly empty, so only the
+  // bins they fill are kept during the loop. The 2D templates have at most
+  // ~100 bins and stay dense
+  static const int sparse_cells = 500;
+  bool isSparse(int ncells) { return ncells >= sparse_cells; }
+
+  // true if something needs the bin of every 2D fill
+  bool tracking() {
+    return (recorder && recorder->isEnabled()) || (variations && variations->isEnabled()) || (replicas && replicas->isEnabled());
+  }
+
+  // fill a 2D template through its fast_hist, keeping the weight factors if
+  // a recorder is set and filling the same bin of the weight variations and
+  // bootstrap replicas. Without any of these the fill is only buffered
+  void fill2D(std::string key, Double_t x, Double_t y, Double_t weight) {
+    auto found = fast_2d.find(key);
+    if (found == fast_2d.end()) {
+      found = fast_2d.emplace(key, fast_hist(histos_2d.at(key), isSparse(histos_2d.getNcells(key)))).first;
+    }
+    auto& fast = found->second;
+    if (!tracking()) {
+      fast.push(x, y, weight);
+      return;
+    }
+    auto hist = (TH2F*)fast.getTarget();
+    Int_t bin = fast.fill(x, y, weight);
+    if (recorder) {
+      recorder->record(hist, bin, weight);
+    }
+    if (variations) {
+      variations->fill(hist, bin, weight, fast.isSparse());
+    }
+    if (replicas) {
+      replicas->fill(key, hist, bin, weight);
+    }
+  }
+
+  // fill a 1D plot. Sparse ones are only booked by flush() if they were
+  // filled, so an empty one is neither allocated densely nor written
+  void fill1D(std::string key, Double_t x, Double_t weight) {
+    if (!isSparse(histos_1d.getNcells(key))) {
+      histos_1d.at(key)->Fill(x, weight);
+      return;
+    }
+    auto found = fast_1d.find(key);
+    if (found == fast_1d.end()) {
+      auto prototype = histos_1d.prototype(key);
+      found = fast_1d.emplace(key, fast_hist(prototype, true)).first;
+      found->second.setTarget(histos_1d.isBooked(key) ? histos_1d.at(key) : nullptr);
+      delete prototype;
+    }
+    found->second.push(x, 0., weight);
+  }
+
+  // move the fills into the ROOT histograms, needed before they are read or written.
+  // Every 2D template is booked here, filled or not: combine and the QCD estimate
+  // need the empty template of a process with no events in a region. Only the
+  // control plots stay lazy
+  void flush() {
+    for (auto& fast : fast_1d) {
+      if (!fast.second.getTarget() && !fast.second.isEmpty()) {
+        fast.second.setTarget(histos_1d.at(fast.first));
+      }
+      if (fast.second.getTarget()) {
+        fast.second.flush();
+      }
+    }
+    for (auto& fast : fast_2d) {
+      fast.second.flush();
+    }
+    for (auto& key : histos_2d.getKeys()) {
+      histos_2d.at(key);
+    }
+  }
 
   Float_t deltaR(Float_t eta1, Float_t phi1, Float_t eta2, Float_t phi2) {
     return sqrt(pow(eta1 - eta2, 2) + pow(phi1 - phi2, 2));
@@ -34,143 +115,92 @@ luminosity(35870.),
     {"metphi_JESDown", "_CMS_scale_metphi_clustered_13TeVDown"},
     {"metphi_JESUp", "_CMS_scale_metphi_clustered_13TeVUp"}
   },
-  cross_sections {
-    {"DYJets", 5765.4},
-    {"DYJets1", 5765.4},
-    {"DYJets2", 5765.4},
-    {"DYJets3", 5765.4},
-    {"DYJets4", 5765.4},
-    {"EWKMinus", 20.25},
-    {"EWKPlus", 25.62},
-    {"EWKZ2l", 3.987},
-    {"EWKZ2nu", 10.01},
-    {"HWW_gg125", 48.58 * 0.2137 * 0.3258},
-    {"HWW_vbf125", 3.782 * 0.2137 * 0.3258},
-    {"SMH_VBF110", 4.434 * 0.0791},
-    {"SMH_VBF120", 3.935 * 0.0698},
-    {"SMH_VBF125", 3.782 * 0.0627},
-    {"VBFHtoTauTau125", 3.782 * 0.0627},
-    {"SMH_VBF130", 3.637 * 0.0541},
-    {"SMH_VBF140", 3.492 * 0.0360},
-    {"SMH_gg110", 57.90 * 0.0791},
-    {"SMH_ggH120", 47.38 * 0.0698},
-    {"SMH_ggH125", 44.14 * 0.0627},
-    {"ggHtoTauTau125", 44.14 * 0.0627},
-    {"SMH_ggH130", 41.23 * 0.0541},
-    {"SMH_gg140", 36.0 * 0.0360},
-    {"ST_tW_antitop", 35.6},
-    {"ST_tW_top", 35.6},
-    {"ST_t_antitop", 26.23},
-    {"ST_t_top", 44.07},
-    {"Tbar-tW", 35.6},
-    {"T-tW", 35.6},
-    {"Tbar-tchan", 26.23},
-    {"T-tchan", 44.07},
-    {"TT", 831.76},
-    {"VV2l2nu", 11.95},
-    {"WJets", 61526.7},
-    {"WJets1", 61526.7},
-    {"WJets2", 61526.7},
-    {"WJets3", 61526.7},
-    {"WJets4", 61526.7},
-    {"WGLNu", 489.0},
-    {"WGstarEE", 3.526},
-    {"WGstarMuMu", 2.793},
-    {"WW1l1nu2q", 49.997},
-    {"WZ1l1nu2q", 10.71},
-    {"WZ1l3nu", 3.05},
-    {"WZ2l2Q", 5.595},
-    {"WZ3l1nu", 4.708},
-    {"WMinusHTauTau125", 0.5328 * 0.0627},
-    {"WPlusHTauTau125", 0.840 * 0.0627},
-    {"ZZ2l2q", 3.22},
-    {"ZZ4l", 1.212},
-    {"ZHTauTau125", 0.8839 * 0.062},
-    {"data", 1.0},
-    {"Data", 1.0}
-  }, 
-  histos_1d {
-    {"n70", new TH1F("n70", "n70", 6, 0, 6)},
-    {"cutflow", new TH1F("cutflow", "Cutflow", 12, -0.5, 11.5)},
+  recorder(nullptr),
+  variations(nullptr),
+  replicas(nullptr),
+  histos_1d {gDirectory, {
+    {"n70", {"n70", "n70", 6, 0, 6}},
+    {"cutflow", {"cutflow", "Cutflow", 12, -0.5, 11.5}},
 
-    {"pre_tau_pt", new TH1F("pre_tau_pt", "Tau p_{T};p_{T} [GeV];;", 40, 0., 200)},
-    {"pre_mt", new TH1F("pre_mt", "mt", 50, 0., 100.)},
-    {"pre_tau_iso", new TH1F("pre_tau_iso", "", 50, 0, .3)},
-    {"pre_el_iso", new TH1F("pre_el_iso", "", 50, 0, .3)},
+    {"pre_tau_pt", {"pre_tau_pt", "Tau p_{T};p_{T} [GeV];;", 40, 0., 200}},
+    {"pre_mt", {"pre_mt", "mt", 50, 0., 100.}},
+    {"pre_tau_iso", {"pre_tau_iso", "", 50, 0, .3}},
+    {"pre_el_iso", {"pre_el_iso", "", 50, 0, .3}},
 
-    {"htau_pt", new TH1F("tau_pt", "Tau p_{T};p_{T} [GeV];;", 40, 0., 200)},
-    {"htau_pt_QCD", new TH1F("tau_pt_QCD", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.)},
-    {"htau_pt_SS", new TH1F("tau_pt_SS", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.)},
-    {"htau_pt_WOS", new TH1F("tau_pt_WOS", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.)},
-    {"htau_pt_WSS", new TH1F("tau_pt_WSS", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.)},
-    {"htau_eta", new TH1F("tau_eta", "Tau #eta;#eta [GeV];;", 80, -4., 4.)},
-    {"htau_phi", new TH1F("tau_phi", "Tau #phi;#phi [GeV];;", 15, -3.14, 3.14)},
-    {"htau_phi_QCD", new TH1F("tau_phi_QCD", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
-    {"htau_phi_SS", new TH1F("tau_phi_SS", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
-    {"htau_phi_WOS", new TH1F("tau_phi_WOS", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
-    {"htau_phi_WSS", new TH1F("tau_phi_WSS", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
+    {"htau_pt", {"tau_pt", "Tau p_{T};p_{T} [GeV];;", 40, 0., 200}},
+    {"htau_pt_QCD", {"tau_pt_QCD", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.}},
+    {"htau_pt_SS", {"tau_pt_SS", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.}},
+    {"htau_pt_WOS", {"tau_pt_WOS", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.}},
+    {"htau_pt_WSS", {"tau_pt_WSS", "Tau p_{T}; p_{T} [GeV]", 40, 0., 200.}},
+    {"htau_eta", {"tau_eta", "Tau #eta;#eta [GeV];;", 80, -4., 4.}},
+    {"htau_phi", {"tau_phi", "Tau #phi;#phi [GeV];;", 15, -3.14, 3.14}},
+    {"htau_phi_QCD", {"tau_phi_QCD", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
+    {"htau_phi_SS", {"tau_phi_SS", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
+    {"htau_phi_WOS", {"tau_phi_WOS", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
+    {"htau_phi_WSS", {"tau_phi_WSS", "Tau p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
 
-    {"hel_pt", new TH1F("el_pt", "Electron p_{T};p_{T} [GeV];;", 20, 0., 100)},
-    {"hel_pt_QCD", new TH1F("el_pt_QCD", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.)},
-    {"hel_pt_SS", new TH1F("el_pt_SS", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.)},
-    {"hel_pt_WOS", new TH1F("el_pt_WOS", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.)},
-    {"hel_pt_WSS", new TH1F("el_pt_WSS", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.)},
-    {"hel_eta", new TH1F("el_eta", "Electron #eta;#eta [GeV];;", 80, -4., 4.)},
-    {"hel_phi", new TH1F("el_phi", "Electron #phi;#phi [GeV];;", 15, -3.14, 3.14)},
-    {"hel_phi_QCD", new TH1F("el_phi_QCD", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
-    {"hel_phi_SS", new TH1F("el_phi_SS", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
-    {"hel_phi_WOS", new TH1F("el_phi_WOS", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
-    {"hel_phi_WSS", new TH1F("el_phi_WSS", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14)},
+    {"hel_pt", {"el_pt", "Electron p_{T};p_{T} [GeV];;", 20, 0., 100}},
+    {"hel_pt_QCD", {"el_pt_QCD", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.}},
+    {"hel_pt_SS", {"el_pt_SS", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.}},
+    {"hel_pt_WOS", {"el_pt_WOS", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.}},
+    {"hel_pt_WSS", {"el_pt_WSS", "Electron p_{T}; p_{T} [GeV]", 20, 0., 100.}},
+    {"hel_eta", {"el_eta", "Electron #eta;#eta [GeV];;", 80, -4., 4.}},
+    {"hel_phi", {"el_phi", "Electron #phi;#phi [GeV];;", 15, -3.14, 3.14}},
+    {"hel_phi_QCD", {"el_phi_QCD", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
+    {"hel_phi_SS", {"el_phi_SS", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
+    {"hel_phi_WOS", {"el_phi_WOS", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
+    {"hel_phi_WSS", {"el_phi_WSS", "el p_{T}; p_{T} [GeV]", 15, -3.14, 3.14}},
 
-    {"hmsv", new TH1F("msv", "SV Fit Mass; Mass [GeV];;", 100, 0, 300)},
-    {"hmsv_QCD", new TH1F("msv_QCD", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.)},
-    {"hmsv_SS", new TH1F("msv_SS", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.)},
-    {"hmsv_WOS", new TH1F("msv_WOS", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.)},
-    {"hmsv_WSS", new TH1F("msv_WSS", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.)},
+    {"hmsv", {"msv", "SV Fit Mass; Mass [GeV];;", 100, 0, 300}},
+    {"hmsv_QCD", {"msv_QCD", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.}},
+    {"hmsv_SS", {"msv_SS", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.}},
+    {"hmsv_WOS", {"msv_WOS", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.}},
+    {"hmsv_WSS", {"msv_WSS", "SV Fit Mass; Mass [GeV];;", 100, 0., 300.}},
 
-    {"hmet", new TH1F("met", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
-    {"hmet_QCD", new TH1F("met_QCD", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
-    {"hmet_SS", new TH1F("met_SS", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
-    {"hmet_WOS", new TH1F("met_WOS", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
-    {"hmet_WSS", new TH1F("met_WSS", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
+    {"hmet", {"met", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
+    {"hmet_QCD", {"met_QCD", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
+    {"hmet_SS", {"met_SS", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
+    {"hmet_WOS", {"met_WOS", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
+    {"hmet_WSS", {"met_WSS", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
 
-    {"hmt", new TH1F("mt", "MT", 50, 0, 100)},
-    {"hmt_QCD", new TH1F("mt_QCD", "MT", 50, 0, 100)},
-    {"hmt_SS", new TH1F("mt_SS", "MT", 50, 0, 100)},
-    {"hmt_WOS", new TH1F("mt_WOS", "MT", 50, 0, 100)},
-    {"hmt_WSS", new TH1F("mt_WSS", "MT", 50, 0, 100)},
+    {"hmt", {"mt", "MT", 50, 0, 100}},
+    {"hmt_QCD", {"mt_QCD", "MT", 50, 0, 100}},
+    {"hmt_SS", {"mt_SS", "MT", 50, 0, 100}},
+    {"hmt_WOS", {"mt_WOS", "MT", 50, 0, 100}},
+    {"hmt_WSS", {"mt_WSS", "MT", 50, 0, 100}},
 
-    {"hmjj", new TH1F("mjj", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmjj_QCD", new TH1F("mjj_QCD", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmjj_SS", new TH1F("mjj_SS", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmjj_WOS", new TH1F("mjj_WOS", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmjj_WSS", new TH1F("mjj_WSS", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
+    {"hmjj", {"mjj", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmjj_QCD", {"mjj_QCD", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmjj_SS", {"mjj_SS", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmjj_WOS", {"mjj_WOS", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmjj_WSS", {"mjj_WSS", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
 
-    {"hmvis", new TH1F("mvis", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmvis_QCD", new TH1F("mvis_QCD", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmvis_SS", new TH1F("mvis_SS", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmvis_WOS", new TH1F("mvis_WOS", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
-    {"hmvis_WSS", new TH1F("mvis_WSS", "Dijet Mass; Mass [GeV];;", 100, 0, 200)},
+    {"hmvis", {"mvis", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmvis_QCD", {"mvis_QCD", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmvis_SS", {"mvis_SS", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmvis_WOS", {"mvis_WOS", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
+    {"hmvis_WSS", {"mvis_WSS", "Dijet Mass; Mass [GeV];;", 100, 0, 200}},
 
-    {"hmetphi", new TH1F("metphi", "Missing E_{T} #phi;Missing E_{T} [GeV];;", 60, -3.14, 3.14)},
-    {"hmet_x", new TH1F("met_x", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
-    {"hmet_y", new TH1F("met_y", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
-    {"hmet_pt", new TH1F("met_pt", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500)},
+    {"hmetphi", {"metphi", "Missing E_{T} #phi;Missing E_{T} [GeV];;", 60, -3.14, 3.14}},
+    {"hmet_x", {"met_x", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
+    {"hmet_y", {"met_y", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
+    {"hmet_pt", {"met_pt", "Missing E_{T};Missing E_{T} [GeV];;", 100, 0., 500}},
 
-    {"hnjets", new TH1F("njets", "N(jets)", 10, -0.5, 9.5)},
-    {"hNGenJets", new TH1F("NGenJets", "Number of Gen Jets", 12, -0.5, 11.5)},
+    {"hnjets", {"njets", "N(jets)", 10, -0.5, 9.5}},
+    {"hNGenJets", {"NGenJets", "Number of Gen Jets", 12, -0.5, 11.5}},
 
-    {"pt_sv", new TH1F("pt_sv", "pt_sv", 50, 0., 500.)},
-    {"m_sv", new TH1F("m_sv", "m_sv", 50, 30., 180.)},
-    {"Dbkg_VBF", new TH1F("Dbkg_VBF", "Dbkg_VBF", 50, 0., 1.)},
-    {"Phi", new TH1F("Phi", "Phi", 50, -3.14, 3.14)},
-    {"Phi1", new TH1F("Phi1", "Phi1", 50, -3.14, 3.14)},
-    {"Q2V1", new TH1F("Q2V1", "Q2V1", 1000, 0., 1000000.)},
-    {"Q2V2", new TH1F("Q2V2", "Q2V2", 1000, 0., 1000000.)},
-    {"costheta1", new TH1F("costheta1", "costheta1", 50, -1., 1.)},
-    {"costheta2", new TH1F("costheta2", "costheta2", 50, -1., 1.)},
-    {"costhetastar", new TH1F("costhetastar", "costhetastar", 50, -1., 1.)}
-  }
+    {"pt_sv", {"pt_sv", "pt_sv", 50, 0., 500.}},
+    {"m_sv", {"m_sv", "m_sv", 50, 30., 180.}},
+    {"Dbkg_VBF", {"Dbkg_VBF", "Dbkg_VBF", 50, 0., 1.}},
+    {"Phi", {"Phi", "Phi", 50, -3.14, 3.14}},
+    {"Phi1", {"Phi1", "Phi1", 50, -3.14, 3.14}},
+    {"Q2V1", {"Q2V1", "Q2V1", 1000, 0., 1000000.}},
+    {"Q2V2", {"Q2V2", "Q2V2", 1000, 0., 1000000.}},
+    {"costheta1", {"costheta1", "costheta1", 50, -1., 1.}},
+    {"costheta2", {"costheta2", "costheta2", 50, -1., 1.}},
+    {"costhetastar", {"costhetastar", "costhetastar", 50, -1., 1.}}
+  }},
+  histos_2d {fout, {}}
     {
       std::string suffix = systematics[syst];  
 
@@ -189,76 +219,37 @@ luminosity(35870.),
       Int_t binnum_taupt = sizeof(bins_taupt) / sizeof(Float_t) - 1;
       Int_t binnum_mjj = sizeof(bins_mjj) / sizeof(Float_t) - 1;
 
-      fout->mkdir("et_0jet");
-      fout->mkdir("et_boosted");
-      fout->mkdir("et_ZH");
-      fout->mkdir("et_vbf");
-      fout->mkdir("et_antiiso_0jet_cr");
-      fout->mkdir("et_antiiso_boosted_cr");
-      fout->mkdir("et_antiiso_vbf_cr");
-      fout->mkdir("et_antiiso_ZH_cr");
-      fout->mkdir("et_wjets_0jet_cr");
-      fout->mkdir("et_wjets_boosted_cr");
-      fout->mkdir("et_wjets_vbf_cr");
-      fout->mkdir("et_wjets_ZH_cr");
-      fout->mkdir("et_antiiso_0jet_crSS");
-      fout->mkdir("et_antiiso_boosted_crSS");
-      fout->mkdir("et_antiiso_vbf_crSS");
-      fout->mkdir("et_antiiso_ZH_crSS");
-      fout->mkdir("et_wjets_0jet_crSS");
-      fout->mkdir("et_wjets_boosted_crSS");
-      fout->mkdir("et_wjets_vbf_crSS");
-      fout->mkdir("et_wjets_ZH_crSS");
+      auto edges = [](Float_t* bins, Int_t nbins) { return std::vector<double>(bins, bins + nbins + 1); };
 
       // Signal Region
-      fout->cd("et_0jet");
-      histos_2d.insert({"h0_OS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_taupt, bins_taupt, binnum0, bins0)});
-      fout->cd("et_boosted");
-      histos_2d.insert({"h1_OS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_pth, bins_pth, binnum1, bins1)});
-      fout->cd("et_vbf");
-      histos_2d.insert({"h2_OS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
-      fout->cd("et_ZH");
-      histos_2d.insert({"h3_OS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
+      histos_2d.add("h0_OS", {"et_0jet", name + suffix, "Invariant mass", edges(bins_taupt, binnum_taupt), edges(bins0, binnum0)});
+      histos_2d.add("h1_OS", {"et_boosted", name + suffix, "Invariant mass", edges(bins_pth, binnum_pth), edges(bins1, binnum1)});
+      histos_2d.add("h2_OS", {"et_vbf", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
+      histos_2d.add("h3_OS", {"et_ZH", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
 
       // QCD Region
-      fout->cd("et_antiiso_0jet_cr");
-      histos_2d.insert({"h0_QCD", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_taupt, bins_taupt, binnum0, bins0)});
-      fout->cd("et_antiiso_boosted_cr");
-      histos_2d.insert({"h1_QCD", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_pth, bins_pth, binnum1, bins1)});
-      fout->cd("et_antiiso_vbf_cr");
-      histos_2d.insert({"h2_QCD", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
-      fout->cd("et_antiiso_ZH_cr");
-      histos_2d.insert({"h3_QCD", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
+      histos_2d.add("h0_QCD", {"et_antiiso_0jet_cr", name + suffix, "Invariant mass", edges(bins_taupt, binnum_taupt), edges(bins0, binnum0)});
+      histos_2d.add("h1_QCD", {"et_antiiso_boosted_cr", name + suffix, "Invariant mass", edges(bins_pth, binnum_pth), edges(bins1, binnum1)});
+      histos_2d.add("h2_QCD", {"et_antiiso_vbf_cr", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
+      histos_2d.add("h3_QCD", {"et_antiiso_ZH_cr", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
 
       // W Region
-      fout->cd("et_wjets_0jet_cr");
-      histos_2d.insert({"h0_WOS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_taupt, bins_taupt, binnum0, bins0)});
-      fout->cd("et_wjets_boosted_cr");
-      histos_2d.insert({"h1_WOS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_pth, bins_pth, binnum1, bins1)});
-      fout->cd("et_wjets_vbf_cr");
-      histos_2d.insert({"h2_WOS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
-      fout->cd("et_wjets_ZH_cr");
-      histos_2d.insert({"h3_WOS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
+      histos_2d.add("h0_WOS", {"et_wjets_0jet_cr", name + suffix, "Invariant mass", edges(bins_taupt, binnum_taupt), edges(bins0, binnum0)});
+      histos_2d.add("h1_WOS", {"et_wjets_boosted_cr", name + suffix, "Invariant mass", edges(bins_pth, binnum_pth), edges(bins1, binnum1)});
+      histos_2d.add("h2_WOS", {"et_wjets_vbf_cr", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
+      histos_2d.add("h3_WOS", {"et_wjets_ZH_cr", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
 
       // Same-sign
-      fout->cd("et_antiiso_0jet_crSS");
-      histos_2d.insert({"h0_SS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_taupt, bins_taupt, binnum0, bins0)});
-      fout->cd("et_antiiso_boosted_crSS");
-      histos_2d.insert({"h1_SS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_pth, bins_pth, binnum1, bins1)});
-      fout->cd("et_antiiso_vbf_crSS");
-      histos_2d.insert({"h2_SS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
-      fout->cd("et_antiiso_ZH_crSS");
-      histos_2d.insert({"h3_SS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
+      histos_2d.add("h0_SS", {"et_antiiso_0jet_crSS", name + suffix, "Invariant mass", edges(bins_taupt, binnum_taupt), edges(bins0, binnum0)});
+      histos_2d.add("h1_SS", {"et_antiiso_boosted_crSS", name + suffix, "Invariant mass", edges(bins_pth, binnum_pth), edges(bins1, binnum1)});
+      histos_2d.add("h2_SS", {"et_antiiso_vbf_crSS", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
+      histos_2d.add("h3_SS", {"et_antiiso_ZH_crSS", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
 
       // W Same-sign
-      fout->cd("et_wjets_0jet_crSS");
-      histos_2d.insert({"h0_WSS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_taupt, bins_taupt, binnum0, bins0)});
-      fout->cd("et_wjets_boosted_crSS");
-      histos_2d.insert({"h1_WSS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_pth, bins_pth, binnum1, bins1)});
-      fout->cd("et_wjets_vbf_crSS");
-      histos_2d.insert({"h2_WSS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
-      fout->cd("et_wjets_ZH_crSS");
-      histos_2d.insert({"h3_WSS", new TH2F((name + suffix).c_str(), "Invariant mass", binnum_mjj, bins_mjj, binnum2, bins2)});
+      histos_2d.add("h0_WSS", {"et_wjets_0jet_crSS", name + suffix, "Invariant mass", edges(bins_taupt, binnum_taupt), edges(bins0, binnum0)});
+      histos_2d.add("h1_WSS", {"et_wjets_boosted_crSS", name + suffix, "Invariant mass", edges(bins_pth, binnum_pth), edges(bins1, binnum1)});
+      histos_2d.add("h2_WSS", {"et_wjets_vbf_crSS", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
+      histos_2d.add("h3_WSS", {"et_wjets_ZH_crSS", name + suffix, "Invariant mass", edges(bins_mjj, binnum_mjj), edges(bins2, binnum2)});
 }
 
 double GetZmmSF(float jets, float mj, float pthi, float taupt, float syst) {
@@ -1,61 +1,6 @@
 #include <map>
 
 static double luminosity(35870.);
-static std::map<std::string, double> cross_sections {
-  {"DYJets", 5765.4},
-  {"DYJets1", 5765.4},
-  {"DYJets2", 5765.4},
-  {"DYJets3", 5765.4},
-  {"DYJets4", 5765.4},
-  {"EWKMinus", 20.25},
-  {"EWKPlus", 25.62},
-  {"EWKZ2l", 3.987},
-  {"EWKZ2nu", 10.01},
-  {"HWW_gg125", 48.58*0.2137*0.3258},
-  {"HWW_vbf125", 3.782*0.2137*0.3258},
-  {"SMH_VBF110", 4.434*0.0791},
-  {"SMH_VBF120", 3.935*0.0698},
-  {"SMH_VBF125", 3.782*0.0627},
-  {"VBFHtoTauTau125", 3.782*0.0627},
-  {"SMH_VBF130", 3.637*0.0541},
-  {"SMH_VBF140", 3.492*0.0360},
-  {"SMH_gg110", 57.90*0.0791},
-  {"SMH_ggH120", 47.38*0.0698},
-  {"SMH_ggH125", 44.14*0.0627},
-  {"ggHtoTauTau125", 44.14*0.0627},
-  {"SMH_ggH130", 41.23*0.0541},
-  {"SMH_gg140", 36.0*0.0360},
-  {"ST_tW_antitop", 35.6},
-  {"ST_tW_top", 35.6},
-  {"ST_t_antitop", 26.23},
-  {"ST_t_top", 44.07},
-  {"Tbar-tW", 35.6},
-  {"T-tW", 35.6},
-  {"Tbar-tchan", 26.23},
-  {"T-tchan", 44.07},
-  {"TT", 831.76},
-  {"VV2l2nu", 11.95},
-  {"WJets", 61526.7},
-  {"WJets1", 61526.7},
-  {"WJets2", 61526.7},
-  {"WJets3", 61526.7},
-  {"WJets4", 61526.7},
-  {"WGLNu", 489.0},
-  {"WGstarEE", 3.526},
-  {"WGstarMuMu", 2.793},
-  {"WW1l1nu2q", 49.997},
-  {"WZ1l1nu2q", 10.71},
-  {"WZ1l3nu", 3.05},
-  {"WZ2l2Q", 5.595},
-  {"WZ3l1nu", 4.708},
-  {"WMinusHTauTau125", 0.5328*0.0627},
-  {"WPlusHTauTau125", 0.840*0.0627},
-  {"ZZ2l2q", 3.22},
-  {"ZZ4l", 1.212},
-  {"ZHTauTau125", 0.8839*0.062},
-  {"data", 1.0},
-  {"Data", 1.0}
-};
 
 // do the mt calculation
 static Float_t calculate_mt(muon* const el, Float_t met_x, Float_t met_y, Float_t met_pt) {
@@ -0,0 +1,117 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include "TH1.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To normalize W+jets to the data in the high //
+// mT control region. The analyzers fill grabbag/n70    //
+// with the events of that region: bin 1 inclusive,     //
+// then one bin per category (0jet, boosted, vbf). The  //
+// factor of a category is (data - other bkg) / W in    //
+// its bin, taken from the merged histograms. Every     //
+// histogram of the W group, nominal and systematics,   //
+// is scaled by the factor of the category in its       //
+// directory name, or by the inclusive factor if the    //
+// category has no bin of its own.                      //
+//////////////////////////////////////////////////////////
+class w_normalization {
+private:
+  merged_output *merged;
+  std::string data_name, w_name;
+  std::map<std::string, int> bins;              // n70 bin of each category
+  std::map<int, double> factors;                // by n70 bin
+
+  static double getCount(merge_group*, int);
+  int getBin(std::string);
+
+public:
+  w_normalization (merged_output*, std::string, std::string);
+  virtual ~w_normalization () {};
+
+  bool measure();
+  void apply();
+};
+
+w_normalization::w_normalization(merged_output* m, std::string data, std::string w) :
+  merged(m),
+  data_name(data),
+  w_name(w),
+  bins {
+    {"0jet", 2},
+    {"boosted", 3},
+    {"vbf", 4}
+  }
+  {}
+
+// content of an n70 bin, summed over every process in the group
+double w_normalization::getCount(merge_group* group, int bin) {
+  auto found = group->dirs.find("grabbag");
+  if (found == group->dirs.end()) {
+    return 0.;
+  }
+  auto hist = found->second.find("n70");
+  return hist == found->second.end() ? 0. : hist->second->GetBinContent(bin);
+}
+
+// n70 bin of the category in a directory name like et_antiiso_boosted_cr, 1 if none
+int w_normalization::getBin(std::string dir) {
+  std::stringstream ss(dir);
+  std::string token;
+  while (std::getline(ss, token, '_')) {
+    auto found = bins.find(token);
+    if (found != bins.end()) {
+      return found->second;
+    }
+  }
+  return 1;
+}
+
+// false if there is no data or W to normalize
+bool w_normalization::measure() {
+  auto data = merged->find(data_name);
+  auto wjets = merged->find(w_name);
+  if (!data || !wjets) {
+    std::cerr << "No " << (data ? w_name : data_name) << " group to normalize W+jets with" << std::endl;
+    return false;
+  }
+
+  std::vector<int> all_bins = {1};
+  for (auto& bin : bins) {
+    all_bins.push_back(bin.second);
+  }
+  for (auto bin : all_bins) {
+    double numerator = getCount(data, bin);
+    for (auto& group : merged->getGroups()) {
+      if (group.type == "bkg" && group.name != w_name) {
+        numerator -= getCount(&group, bin);
+      }
+    }
+    double denominator = getCount(wjets, bin);
+    if (denominator <= 0. || numerator <= 0.) {
+      std::cerr << "No W+jets excess in bin " << bin << " of n70, leaving it unscaled" << std::endl;
+      factors[bin] = 1.;
+    } else {
+      factors[bin] = numerator / denominator;
+    }
+  }
+
+  std::cout << "W+jets normalization: inclusive " << factors[1];
+  for (auto& bin : bins) {
+    std::cout << ", " << bin.first << " " << factors[bin.second];
+  }
+  std::cout << std::endl;
+  return true;
+}
+
+void w_normalization::apply() {
+  auto wjets = merged->find(w_name);
+  for (auto& dir : wjets->dirs) {
+    double factor = factors[getBin(dir.first)];
+    for (auto& hist : dir.second) {
+      merged_output::scaleBins(hist.second, factor);
+    }
+  }
+}
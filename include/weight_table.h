@@ -0,0 +1,173 @@
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include "TH2F.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To keep the factors making up the event     //
+// weight of every event filled into a 2D template, so  //
+// reweight.cc can rebuild the templates with a factor  //
+// changed or dropped without reading the input again.  //
+// The analyzers multiply each correction in through    //
+// apply(), and Helper::fill2D records the histogram    //
+// and global bin of every fill. Anything not split out //
+// ends up in the "other" factor, so the product of all //
+// factors is always the weight that was filled.        //
+// Layout: weight_header, ncomponents names, nkeys      //
+// names (dir/histogram), nevents rows of float         //
+// factors, then nfills weight_fill rows. Each name is  //
+// its UInt_t length followed by its characters.        //
+//////////////////////////////////////////////////////////
+struct weight_header {
+  char magic[8];      // "HTTWGT2"
+  Long64_t ncomponents;
+  Long64_t nkeys;
+  Long64_t nevents;
+  Long64_t nfills;
+};
+
+struct weight_fill {
+  UInt_t event;       // row of factors
+  UShort_t key;       // histogram
+  Int_t bin;          // global bin
+};
+
+class weight_table {
+public:
+  enum component { norm, pileup, genweight, trigger, id, tracking, tau_id, antilepton, zpt, zmm, toppt, nnlops, other, n_components };
+
+  static const char* names[n_components];
+  static const char* magic;
+
+private:
+  bool enabled, stored;
+  std::string file_name;
+  std::array<float, n_components> current;
+  std::vector<std::array<float, n_components>> events;
+  std::vector<weight_fill> fills;
+  std::vector<std::string> keys;
+  std::unordered_map<TH2F*, UShort_t> key_index;
+
+public:
+  weight_table (bool, std::string);
+  virtual ~weight_table () {};
+
+  // getters
+  bool isEnabled()      { return enabled;       };
+  size_t getNEvents()   { return events.size(); };
+
+  void start(double);
+  double apply(component, double);
+  void record(TH2F*, Int_t, double);
+  bool write();
+
+  static bool writeName(FILE*, const std::string&);
+  static bool readName(FILE*, std::string&);
+};
+
+const char* weight_table::names[weight_table::n_components] = {
+  "norm", "pileup", "genweight", "trigger", "id", "tracking", "tau_id", "antilepton", "zpt", "zmm", "toppt", "nnlops", "other"
+};
+
+// bumped whenever the layout changes
+const char* weight_table::magic = "HTTWGT2";
+
+weight_table::weight_table(bool enable, std::string fname) :
+  enabled(enable),
+  stored(false),
+  file_name(fname)
+{
+  current.fill(1.);
+}
+
+// new event starting from the normalization (lumi * xs / N or stitching weight)
+void weight_table::start(double norm_weight) {
+  current.fill(1.);
+  current[norm] = norm_weight;
+  stored = false;
+}
+
+// multiply a factor into its component and return it, i.e. evtwt *= weights.apply(weight_table::zpt, sf)
+double weight_table::apply(component comp, double factor) {
+  current[comp] *= factor;
+  return factor;
+}
+
+// the first fill of an event stores its factors, every fill stores the bin
+void weight_table::record(TH2F* hist, Int_t bin, double weight) {
+  if (!enabled) {
+    return;
+  }
+  if (!stored) {
+    double product(1.);
+    for (int i = 0; i < other; i++) {
+      product *= current[i];
+    }
+    current[other] = product != 0. ? weight / product : 0.;
+    events.push_back(current);
+    stored = true;
+  }
+
+  auto found = key_index.find(hist);
+  if (found == key_index.end()) {
+    found = key_index.insert({hist, static_cast<UShort_t>(keys.size())}).first;
+    keys.push_back(std::string(hist->GetDirectory()->GetName()) + "/" + hist->GetName());
+  }
+  fills.push_back({static_cast<UInt_t>(events.size() - 1), found->second, bin});
+}
+
+bool weight_table::write() {
+  if (!enabled) {
+    return true;
+  }
+
+  weight_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, magic, 8);
+  header.ncomponents = n_components;
+  header.nkeys = keys.size();
+  header.nevents = events.size();
+  header.nfills = fills.size();
+
+  // write to a temporary file first so an interrupted job never leaves a bad table
+  std::string tmp_name = file_name + ".tmp";
+  auto fwgt = fopen(tmp_name.c_str(), "wb");
+  bool good = fwgt && fwrite(&header, sizeof(header), 1, fwgt) == 1;
+  for (int i = 0; good && i < n_components; i++) {
+    good = writeName(fwgt, names[i]);
+  }
+  for (size_t i = 0; good && i < keys.size(); i++) {
+    good = writeName(fwgt, keys.at(i));
+  }
+  good = good && fwrite(events.data(), sizeof(events.front()), events.size(), fwgt) == events.size();
+  good = good && fwrite(fills.data(), sizeof(weight_fill), fills.size(), fwgt) == fills.size();
+  if (fwgt && fclose(fwgt) != 0) {
+    good = false;
+  }
+  if (!good || std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+    std::cerr << "Unable to write weight table " << file_name << std::endl;
+    return false;
+  }
+  std::cout << "Wrote the weight factors of " << events.size() << " events (" << fills.size() << " fills) to " << file_name << std::endl;
+  return true;
+}
+
+// length-prefixed, so histogram keys of any length are kept whole
+bool weight_table::writeName(FILE* fwgt, const std::string& name) {
+  UInt_t length = name.size();
+  return fwrite(&length, sizeof(length), 1, fwgt) == 1 && fwrite(name.data(), 1, length, fwgt) == length;
+}
+
+bool weight_table::readName(FILE* fwgt, std::string& name) {
+  UInt_t length;
+  if (fread(&length, sizeof(length), 1, fwgt) != 1) {
+    return false;
+  }
+  name.resize(length);
+  return length == 0 || fread(&name[0], 1, length, fwgt) == length;
+}
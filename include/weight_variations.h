@@ -0,0 +1,143 @@
+#include <array>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include "TH2F.h"
+#include "TArrayD.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To fill the shapes of weight systematics    //
+// (Zmm SF up/down, tt trigger SF factors) in the same  //
+// pass as the nominal templates. Each event carries a  //
+// fixed-size array of alternative weights, given as    //
+// ratios to the nominal weight, and Helper::fill2D     //
+// adds all of them to the bin the nominal fill found.  //
+// The variations of a bin sit next to each other, so   //
+// one fill is a single loop over contiguous memory.    //
+// Sparse templates (see fast_hist.h) only get rows for //
+// the bins that were filled. Each variation is written //
+// next to its nominal template as <name><suffix>.      //
+//   --variations : fill the variation templates        //
+//////////////////////////////////////////////////////////
+class weight_variations {
+public:
+  static const int max_variations = 8;
+
+private:
+  struct shapes {
+    bool sparse;
+    std::vector<double> contents, sumw2;    // ncells (or filled bins if sparse) * nvariations, bin-major
+    std::unordered_map<Int_t, size_t> rows; // sparse: first index of each filled bin
+  };
+
+  bool enabled;
+  int nvariations;
+  std::vector<std::string> suffixes;
+  std::array<double, max_variations> ratios;
+  std::unordered_map<TH2F*, shapes> histos;
+
+public:
+  weight_variations (bool, std::vector<std::string>);
+  virtual ~weight_variations () {};
+
+  // getters
+  bool isEnabled()      { return enabled;     };
+  int getN()            { return nvariations; };
+
+  void start();
+  void set(int, double, double);
+  void fill(TH2F*, Int_t, double, bool);
+  void write(lazy_histos_2d*);
+};
+
+weight_variations::weight_variations(bool enable, std::vector<std::string> names) :
+  enabled(enable && !names.empty()),
+  nvariations(std::min(static_cast<int>(names.size()), max_variations)),
+  suffixes(names)
+{
+  if (static_cast<int>(names.size()) > max_variations) {
+    std::cerr << "Only the first " << max_variations << " weight variations are filled" << std::endl;
+  }
+  ratios.fill(1.);
+}
+
+// new event, all variations equal to the nominal weight
+void weight_variations::start() {
+  ratios.fill(1.);
+}
+
+// variation i multiplies the weight by varied / nominal
+void weight_variations::set(int i, double varied, double nominal) {
+  ratios[i] *= nominal != 0. ? varied / nominal : 0.;
+}
+
+void weight_variations::fill(TH2F* hist, Int_t bin, double weight, bool sparse) {
+  if (!enabled) {
+    return;
+  }
+  auto found = histos.find(hist);
+  if (found == histos.end()) {
+    size_t size = sparse ? 0 : static_cast<size_t>(hist->GetNcells()) * nvariations;
+    found = histos.insert({hist, {sparse, std::vector<double>(size, 0.), std::vector<double>(size, 0.), {}}}).first;
+  }
+
+  auto& shape = found->second;
+  size_t first = static_cast<size_t>(bin) * nvariations;
+  if (shape.sparse) {
+    auto row = shape.rows.insert({bin, shape.contents.size()});
+    if (row.second) {
+      shape.contents.resize(shape.contents.size() + nvariations, 0.);
+      shape.sumw2.resize(shape.sumw2.size() + nvariations, 0.);
+    }
+    first = row.first->second;
+  }
+  double *contents = &shape.contents[first];
+  double *sumw2 = &shape.sumw2[first];
+  for (int i = 0; i < nvariations; i++) {
+    double w = weight * ratios[i];
+    contents[i] += w;
+    sumw2[i] += w * w;
+  }
+}
+
+// one histogram per variation of every template, in the directory of the nominal
+void weight_variations::write(lazy_histos_2d* templates) {
+  if (!enabled) {
+    return;
+  }
+  auto dir = gDirectory;
+  for (auto& entry : *templates) {
+    auto nominal = entry.second;
+    auto found = histos.find(nominal);
+    for (int i = 0; i < nvariations; i++) {
+      nominal->GetDirectory()->cd();
+      auto varied = (TH2F*)nominal->Clone((std::string(nominal->GetName()) + suffixes.at(i)).c_str());
+      varied->Reset();
+      if (found == histos.end()) {
+        continue;
+      }
+      if (varied->GetSumw2N() == 0) {
+        varied->Sumw2();
+      }
+      auto& shape = found->second;
+      if (shape.sparse) {
+        for (auto& row : shape.rows) {
+          varied->SetBinContent(row.first, shape.contents[row.second + i]);
+          varied->GetSumw2()->fArray[row.first] = shape.sumw2[row.second + i];
+        }
+      } else {
+        for (int bin = 0; bin < varied->GetNcells(); bin++) {
+          varied->SetBinContent(bin, shape.contents[static_cast<size_t>(bin) * nvariations + i]);
+          varied->GetSumw2()->fArray[bin] = shape.sumw2[static_cast<size_t>(bin) * nvariations + i];
+        }
+      }
+      varied->ResetStats();
+      varied->SetEntries(nominal->GetEntries());
+    }
+  }
+  dir->cd();
+  std::cout << "Filled " << nvariations << " weight variations of " << templates->size() << " templates" << std::endl;
+}
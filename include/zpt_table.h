@@ -0,0 +1,105 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "TH2.h"
+#include "TFile.h"
+#include "TDirectory.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To look up the Z-pT/mass weights of DY      //
+// events without going through the TH2F. The weights   //
+// are copied once into a contiguous table and the bins //
+// are found with the fast_axis of fast_hist.h. What    //
+// happens outside the range of the histogram is        //
+// chosen explicitly:                                   //
+//   --zpt-range clamp : weight of the nearest bin      //
+//                       inside the range (default)     //
+//   --zpt-range unity : weight 1                       //
+//   --zpt-range root  : under/overflow bin contents,   //
+//                       like TH2F::GetBinContent with  //
+//                       FindBin                        //
+// The table is read-only once built, so one can be     //
+// shared by all threads and channels.                  //
+//////////////////////////////////////////////////////////
+class zpt_table {
+public:
+  enum range_policy { clamp, unity, root };
+
+private:
+  bool valid;
+  range_policy policy;
+  std::vector<fast_axis> axes;          // mass (x), pT (y)
+  int nx, ny;
+  std::vector<float> weights;           // (nx + 2) * (ny + 2), by ROOT global bin
+
+public:
+  zpt_table (std::string, std::string, range_policy);
+  virtual ~zpt_table () {};
+
+  static bool readPolicy(std::string, range_policy&);
+
+  // getters
+  bool isValid()        { return valid; };
+
+  double weight(double gen_m, double gen_pt) const {
+    int bx = axes[0].find(gen_m);
+    int by = axes[1].find(gen_pt);
+    if (policy == clamp) {
+      bx = bx < 1 ? 1 : bx > nx ? nx : bx;
+      by = by < 1 ? 1 : by > ny ? ny : by;
+    } else if (policy == unity && (bx < 1 || bx > nx || by < 1 || by > ny)) {
+      return 1.;
+    }
+    return weights[bx + (nx + 2) * by];
+  }
+
+  void weight(const double*, const double*, double*, size_t) const;
+};
+
+zpt_table::zpt_table(std::string fname, std::string hname, range_policy p) :
+  valid(false),
+  policy(p),
+  nx(0),
+  ny(0)
+{
+  auto dir = gDirectory;
+  auto fin = TFile::Open(fname.c_str(), "READ");
+  auto hist = fin && !fin->IsZombie() ? dynamic_cast<TH2*>(fin->Get(hname.c_str())) : nullptr;
+  if (!hist) {
+    std::cerr << "Unable to read the Z-pT weights " << hname << " from " << fname << std::endl;
+    dir->cd();
+    return;
+  }
+
+  axes.push_back(fast_axis(hist->GetXaxis()));
+  axes.push_back(fast_axis(hist->GetYaxis()));
+  nx = hist->GetNbinsX();
+  ny = hist->GetNbinsY();
+  for (int bin = 0; bin < hist->GetNcells(); bin++) {
+    weights.push_back(hist->GetBinContent(bin));
+  }
+  fin->Close();
+  dir->cd();
+  valid = true;
+}
+
+bool zpt_table::readPolicy(std::string name, range_policy& value) {
+  if (name.empty() || name == "clamp") {
+    value = clamp;
+  } else if (name == "unity") {
+    value = unity;
+  } else if (name == "root") {
+    value = root;
+  } else {
+    std::cerr << "Unknown Z-pT range policy " << name << ", use clamp, unity or root" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// n weights at once, i.e. for a batch of events
+void zpt_table::weight(const double* gen_m, const double* gen_pt, double* result, size_t n) const {
+  for (size_t i = 0; i < n; i++) {
+    result[i] = weight(gen_m[i], gen_pt[i]);
+  }
+}
@@ -17,6 +17,14 @@
 #include "RooMsgService.h"
 
 // user includes
+#include "include/sample_table.h"
+#include "include/lazy_histos.h"
+#include "include/weight_table.h"
+#include "include/weight_variations.h"
+#include "include/bootstrap.h"
+#include "include/fast_hist.h"
+#include "include/zpt_table.h"
+#include "include/nnlops.h"
 #include "include/util.h"
 #include "include/event_info.h"
 #include "include/tau_factory.h"
@@ -26,8 +34,19 @@
 #include "include/SF_factory.h"
 // #include "include/util_mt.h"
 #include "include/btagSF.h"
+#include "include/btag_weights.h"
 #include "include/LumiReweightingStandAlone.h"
 #include "include/CLParser.h"
+#include "include/skim_cache.h"
+#include "include/stitching.h"
+#include "include/input_chain.h"
+#include "include/event_index.h"
+#include "include/event_range.h"
+#include "include/checkpoint.h"
+#include "include/tree_io.h"
+#include "include/column_file.h"
+#include "include/event_pipeline.h"
+#include "include/output_writer.h"
 
 int main(int argc, char* argv[]) {
 
@@ -43,46 +62,87 @@ int main(int argc, char* argv[]) {
   std::string path = parser.Option("-p");
   std::string syst = parser.Option("-u");
   std::string postfix = parser.Option("-P");
-  std::string fname = path + sample + postfix;
-  bool isData = sample.find("Data") != std::string::npos;
-  // bool isData = parser.Flag("-d");
+  bool use_cache = parser.Flag("-c");
+  std::string checkpoint_every = parser.Option("--checkpoint");
+
+  // data/MC, cross sections and stitching come from inputs/samples.txt (sample_table.h)
+  if (!sample_table::get().check(sample, name)) {
+    return 1;
+  }
+  bool isData = sample_table::get().isData(sample);
+
   std::string systname = "";
   if (!syst.empty()) {
     systname = "_" + syst;
   }
 
-  // open input file
-  std::cout << "Opening file... " << sample << std::endl;
-  auto fin = TFile::Open((fname+".root").c_str());
-  std::cout << "Loading Ntuple..." << std::endl;
-  auto ntuple = (TTree*)fin->Get("mutau_tree");
+  // open input files, several samples are read as one chain (input_chain.h)
+  tree_io::configure(parser);
+  input_chain input(sample, path, postfix + ".root", "mutau_tree");
+  if (!input.isValid()) {
+    return 1;
+  }
+  auto ntuple = input.getTree();
+
+  // outputs of several samples are named after the process
+  if (input.getNFiles() > 1) {
+    sample = name;
+  }
+
+  // run/lumi/evt index for lumi masks, duplicates and single events (event_index.h)
+  event_index index(parser, input.getFileNames(), ntuple->GetName());
+  if (!index.isValid()) {
+    return 1;
+  }
 
-  // get number of generated events
-  auto counts = (TH1D*)fin->Get("nevents");
-  auto gen_number = counts->GetBinContent(2);
+  // entries passing the event selection from a previous run (skim_cache.h), keyed by
+  // every parameter the cuts before cache.record read. Bump the version whenever
+  // the code of those cuts changes
+  selection_config selection("mt", 1);
+  selection.add("tree", std::string(ntuple->GetName()));
+  selection.add("process", name);
+  selection.add("index", index.getKey());
+  const double muon_pt_min = selection.add("muon_pt_min", 20.);
+  const double muon_eta_max = selection.add("muon_eta_max", 2.1);
+  const double cross_trigger_pt_max = selection.add("cross_trigger_pt_max", 23.);
+  const double tau_pt_min = selection.add("tau_pt_min", 30.);
+  const double tau_eta_max = selection.add("tau_eta_max", 2.3);
+  skim_cache cache(use_cache && !index.isSingleEvent(), "mt", sample + "_" + name, input.getID(), selection.getKey());
+
+  // block of entries handled by this job (event_range.h)
+  event_range range(parser, cache.getN(ntuple->GetEntries()));
+  if (!range.isValid()) {
+    return 1;
+  }
+  if (index.isSingleEvent()) {
+    range.select(index.getSelected(), index.getLabel());
+  }
 
   // create output file
   auto suffix = "_output.root";
   auto prefix = "output/";
   std::string filename;
   if (name == sample) {
-    filename = prefix + name + systname + suffix;
+    filename = prefix + name + systname + range.getLabel() + suffix;
   } else {
-    filename = prefix + sample + std::string("_") + name + systname + suffix;
+    filename = prefix + sample + std::string("_") + name + systname + range.getLabel() + suffix;
   }
-  auto fout = new TFile(filename.c_str(), "RECREATE");
+  // written on several threads and with the chosen compression (output_writer.h)
+  output_writer writer(parser, filename);
+  if (!writer.isValid()) {
+    return 1;
+  }
+  auto fout = writer.open();
   fout->mkdir("grabbag");
   fout->cd("grabbag");
 
   // initialize Helper class
   Helper helper(fout, name, syst);
 
-  // get normalization (lumi & xs are in util.h)
-  double norm;
-  if (isData)
-    norm = 1.0;
-  else
-    norm = helper.getLuminosity() * helper.getCrossSection(sample) / gen_number;
+  // get normalization of each input file (lumi & xs are in util.h)
+  // and the jet-multiplicity weights of stitched W and DY samples
+  stitching stitch(input.getSamples(), path, postfix + ".root", helper);
+  input.normalize(helper, isData, stitch);
 
   ///////////////////////////////////////////////
   // Scale Factors:                            //
@@ -97,8 +157,14 @@ int main(int argc, char* argv[]) {
   TH2F *h_Trk = (TH2F*)f_Trk->Get("ratio_eff_eta3_dr030e030_corr");
 
   // Z-pT reweighting
-  TFile *zpt_file = new TFile("inputs/zpt_weights_2016_BtoH.root");
-  auto zpt_hist = (TH2F*)zpt_file->Get("zptmass_histo");
+  zpt_table::range_policy zpt_range;
+  if (!zpt_table::readPolicy(parser.Option("--zpt-range"), zpt_range)) {
+    return 1;
+  }
+  zpt_table zpt_weights("inputs/zpt_weights_2016_BtoH.root", "zptmass_histo", zpt_range);
+  if (!zpt_weights.isValid()) {
+    return 1;
+  }
 
   //H->tau tau scale factors
   TFile htt_sf_file("inputs/htt_scalefactors_sm_moriond_v1.root");
@@ -115,11 +181,23 @@ int main(int argc, char* argv[]) {
   auto myScaleFactor_id = new SF_factory("LeptonEfficiencies/Muon/Run2016BtoH/Muon_IdIso_IsoLt0p15_2016BtoH_eff.root");
   auto myScaleFactor_idAnti= new SF_factory("LeptonEfficiencies/Muon/Run2016BtoH/Muon_IdIso_antiisolated_Iso0p15to0p3_eff_rb.root");
 
-  TFile * f_NNLOPS = new TFile("inputs/NNLOPS_reweight.root");
-  TGraph * g_NNLOPS_0jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_0jet");
-  TGraph * g_NNLOPS_1jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_1jet");
-  TGraph * g_NNLOPS_2jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_2jet");
-  TGraph * g_NNLOPS_3jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_3jet");
+  // NNLOPS reweighting of ggH
+  nnlops nnlops_weights("inputs/NNLOPS_reweight.root", 0.5, parser.Flag("--nnlops-check"));
+  if (!nnlops_weights.isValid()) {
+    return 1;
+  }
+  if (parser.Flag("--nnlops-check")) {
+    nnlops_weights.check(10000);
+  }
+
+  // compare the b-tag event weight tables to the brute force sum with GetSF (btag_weights.h)
+  if (parser.Flag("--btag-check")) {
+    btag_weights btag(1, 0.5, 1000.);
+    if (!btag.isValid()) {
+      return 1;
+    }
+    btag.check(10000);
+  }
 
   //////////////////////////////////////
   // Final setup:                     //
@@ -137,42 +215,56 @@ int main(int argc, char* argv[]) {
   tau_factory      taus(ntuple);
   jet_factory      jets(ntuple, syst);
   met_factory      met(ntuple, syst);
-  double n70_count;
+  double n70_count(0.);
+
+  // only read the branches bound above, through a tuned cache (tree_io.h)
+  tree_io io(ntuple, parser);
+  if (range.getLast() > range.getFirst()) {
+    io.setup(cache.getEntry(range.getFirst()), cache.getEntry(range.getLast() - 1) + 1);
+  }
+
+  // read entries from a memory-mapped column file if one is given (column_file.h)
+  column_reader columns(parser, input.getFile(0));
+  columns.bind(ntuple);
+
+  // periodically save histograms so an interrupted job can resume (checkpoint.h)
+  std::string job_key = input.getName() + range.getLabel() + (cache.isValid() ? cache.getName() : "");
+  checkpoint ckpt(filename, job_key, checkpoint_every.empty() ? 0 : std::stoll(checkpoint_every), histos, histos_2d);
+  ckpt.setBeforeWrite([&helper]() { helper.flush(); });
+
+  // keep the weight factors of every filled event for reweight.cc (weight_table.h)
+  weight_table weights(parser.Flag("--weights"), filename.substr(0, filename.rfind(".root")) + ".weights");
+  helper.setRecorder(&weights);
+
+  // fill the Zmm SF up/down shapes together with the nominal (weight_variations.h)
+  weight_variations variations(parser.Flag("--variations") && !isData, {"_CMS_htt_zmumuShape_13TeVUp", "_CMS_htt_zmumuShape_13TeVDown"});
+  helper.setVariations(&variations);
+
+  // fill Poisson bootstrap replicas of the signal-region templates (bootstrap.h)
+  std::string bootstrap_replicas = parser.Option("--bootstrap");
+  bootstrap replicas(bootstrap_replicas.empty() ? 0 : std::stoi(bootstrap_replicas));
+  helper.setReplicas(&replicas);
 
   // begin the event loop
-  Int_t nevts = ntuple->GetEntries();
-  for (Int_t i = 0; i < nevts; i++) {
-    ntuple->GetEntry(i);
+  Long64_t first = ckpt.restore(range.getFirst());
+  Long64_t nevts = range.getLast();
+
+  // read entries here or on a separate thread (event_pipeline.h)
+  event_pipeline reader(ntuple, input.getFileNames(), ntuple->GetName(), &cache, &columns, first, nevts, parser);
+  for (Long64_t i = first; i < nevts; i++) {
+    ckpt.update(i);
+    Long64_t entry = reader.load(i);
+    if (!index.accept(entry)) {
+      continue;
+    }
     if (i % 1000 == 0)
       std::cout << "Processing event: " << i << " out of " << nevts << std::endl;
 
     // find the event weight (not lumi*xs if looking at W or Drell-Yan)
-    double evtwt(norm), corrections(1.), sf_trig(1.), sf_trig_anti(1.), sf_id(1.), sf_id_anti(1.);
-    if (name == "W") {
-      if (event.getNumGenJets() == 1)
-        evtwt = 6.8176;
-      else if (event.getNumGenJets() == 2)
-        evtwt = 2.1038;
-      else if (event.getNumGenJets() == 3)
-	evtwt = 0.6889;
-      else if (event.getNumGenJets() == 4)
-        evtwt = 0.6900;
-      else
-        evtwt = 25.446;
-    }
-
-    if (name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
-      if (event.getNumGenJets() == 1)
-        evtwt = 0.45729;
-      else if (event.getNumGenJets() == 2)
-        evtwt = 0.4668;
-      else if (event.getNumGenJets() == 3)
-        evtwt = 0.47995;
-      else if (event.getNumGenJets() == 4)
-        evtwt = 0.39349;
-      else
-        evtwt = 1.4184;
-    }
+    double evtwt(input.getWeight(entry, event.getNumGenJets())), corrections(1.), sf_trig(1.), sf_trig_anti(1.), sf_id(1.), sf_id_anti(1.);
+    weights.start(evtwt);
+    variations.start();
+    replicas.start(event.getRun(), event.getLumi(), event.getEvt());
 
     // fout->cd("grabbag");
     histos->at("cutflow")->Fill(0., 1.);
@@ -190,20 +282,20 @@ int main(int argc, char* argv[]) {
 
     // muon pT > 20 GeV
     auto muon = muons.run_factory();
-    if (muon.getPt() > 20 && fabs(muon.getEta()) < 2.1)  histos->at("cutflow") -> Fill(1., 1);
+    if (muon.getPt() > muon_pt_min && fabs(muon.getEta()) < muon_eta_max)  histos->at("cutflow") -> Fill(1., 1);
     else continue;
 
     // low energy muon passes IsoMu19Tau20
-    if (muon.getPt()<=23 && (event.getPassCrossTrigger()))
+    if (muon.getPt() <= cross_trigger_pt_max && (event.getPassCrossTrigger()))
 	histos->at("cutflow") -> Fill(2., 1);
     // high energy muon passes IsoMu22 || IsoTkMu22 || IsoMu22eta2p1 || IsoTkMu22eta2p1
-    else if(muon.getPt()>23 && event.getPassIsoMu22() && event.getPassIsoTkMu22() && event.getPassIsoMu22eta2p1() && event.getPassIsoTkMu22eta2p1())
+    else if(muon.getPt() > cross_trigger_pt_max && event.getPassIsoMu22() && event.getPassIsoTkMu22() && event.getPassIsoMu22eta2p1() && event.getPassIsoTkMu22eta2p1())
     	histos->at("cutflow") -> Fill(2., 1);
     else continue;
 
     // tau pT > 30 and |eta| < 2.3
     auto tau = taus.run_factory();
-    if (tau.getPt() > 30 && fabs(tau.getEta()) < 2.3) histos->at("cutflow") -> Fill(3., 1);
+    if (tau.getPt() > tau_pt_min && fabs(tau.getEta()) < tau_eta_max) histos->at("cutflow") -> Fill(3., 1);
     else continue;
 
     // check against mu/el
@@ -212,8 +304,6 @@ int main(int argc, char* argv[]) {
     std::cout << "i : " << i << std::endl;
     std::cout << "tau.getAgainstVLooseElectron() : " << tau.getAgainstVLooseElectron() << std::endl;
     std::cout << "tau.getAgainstTightMuon() : " << tau.getAgainstTightMuon() << std::endl;
-    if (tau.getAgainstVLooseElectron())     std::cout << "norm1 : " << norm << std::endl;    
-    if (tau.getAgainstTightMuon())     std::cout << "norm2 : " << norm << std::endl;    
     else continue;
     */
     // end event selection
@@ -235,6 +325,7 @@ int main(int argc, char* argv[]) {
       continue;
 
     histos->at("cutflow") -> Fill(6., 1.);
+    cache.record(entry);
 
     // apply all scale factors/corrections/etc.
     if (!isData) {
@@ -245,7 +336,7 @@ int main(int argc, char* argv[]) {
       
       // tau ID efficiency SF
       if (tau.getGenMatch() == 5)
-        evtwt *= 0.95;
+        evtwt *= weights.apply(weight_table::tau_id, 0.95);
       float eff_tau = 1.0;
       float eff_tau_ratio = 1.0;
       if (muon.getPt()<23) {
@@ -261,27 +352,40 @@ int main(int argc, char* argv[]) {
 	sf_trig       = myScaleFactor_trgMu22->getSF(muon.getPt(),muon.getEta());
 	sf_trig_anti  = myScaleFactor_trgMu22Anti->getSF(muon.getPt(),muon.getEta());
       }
-      evtwt *= (sf_trig * sf_id * lumi_weights->weight(event.getNPU()) * event.getGenWeight());  
+      evtwt *= weights.apply(weight_table::trigger, sf_trig);
+      evtwt *= weights.apply(weight_table::id, sf_id);
+      evtwt *= weights.apply(weight_table::pileup, lumi_weights->weight(event.getNPU()));
+      evtwt *= weights.apply(weight_table::genweight, event.getGenWeight());
       
       // // anti-lepton discriminator SFs
+      double sf_antilep(1.);
       if (tau.getGenMatch() == 2 or tau.getGenMatch() == 4){//Yiwen reminiaod
-	if (fabs(tau.getEta())<0.4) evtwt *= 1.263;
-	else if (fabs(tau.getEta())<0.8) evtwt *= 1.364;
-	else if (fabs(tau.getEta())<1.2) evtwt *= 0.854;
-	else if (fabs(tau.getEta())<1.7) evtwt *= 1.712;
-	else if (fabs(tau.getEta())<2.3) evtwt *= 2.324;
-	if (name == "ZL" && tau.getL2DecayMode() == 0) evtwt *= 0.74; //ZL corrections Laura
-	else if (name == "ZL" && tau.getL2DecayMode() == 1) evtwt *= 1.0;
+	if (fabs(tau.getEta())<0.4) sf_antilep *= 1.263;
+	else if (fabs(tau.getEta())<0.8) sf_antilep *= 1.364;
+	else if (fabs(tau.getEta())<1.2) sf_antilep *= 0.854;
+	else if (fabs(tau.getEta())<1.7) sf_antilep *= 1.712;
+	else if (fabs(tau.getEta())<2.3) sf_antilep *= 2.324;
+	if (name == "ZL" && tau.getL2DecayMode() == 0) sf_antilep *= 0.74; //ZL corrections Laura
+	else if (name == "ZL" && tau.getL2DecayMode() == 1) sf_antilep *= 1.0;
       }
       if (tau.getGenMatch() == 1 or tau.getGenMatch() == 3){//Yiwen
-	if (fabs(tau.getEta())<1.460) evtwt *= 1.213;
-	else if (fabs(tau.getEta())>1.558) evtwt *= 1.375;
+	if (fabs(tau.getEta())<1.460) sf_antilep *= 1.213;
+	else if (fabs(tau.getEta())>1.558) sf_antilep *= 1.375;
+      }
+      evtwt *= weights.apply(weight_table::antilepton, sf_antilep);
+
+      // NNLOPS reweighting of the POWHEG ggH samples
+      if (name.find("ggH") == 0) {
+        evtwt *= weights.apply(weight_table::nnlops, nnlops_weights.weight(int(event.getNumGenJets()), event.getGenPt()));
       }
 
       // Z-pT and Zmm Reweighting
       if (name=="EWKZLL" || name=="EWKZNuNu" || name=="ZTT" || name=="ZLL" || name=="ZL" || name=="ZJ") {
-        evtwt *= zpt_hist->GetBinContent(zpt_hist->GetXaxis()->FindBin(event.getGenM()),zpt_hist->GetYaxis()->FindBin(event.getGenPt()));
-        evtwt *= GetZmmSF(jets.getNjets(), jets.getDijetMass(), Higgs.Pt(), tau.getPt(), 0);
+        evtwt *= weights.apply(weight_table::zpt, zpt_weights.weight(event.getGenM(), event.getGenPt()));
+        double sf_zmm = GetZmmSF(jets.getNjets(), jets.getDijetMass(), Higgs.Pt(), tau.getPt(), 0);
+        evtwt *= weights.apply(weight_table::zmm, sf_zmm);
+        variations.set(0, GetZmmSF(jets.getNjets(), jets.getDijetMass(), Higgs.Pt(), tau.getPt(), 1), sf_zmm);
+        variations.set(1, GetZmmSF(jets.getNjets(), jets.getDijetMass(), Higgs.Pt(), tau.getPt(), -1), sf_zmm);
       } 
 
       // // top-pT Reweighting (only for some systematic)
@@ -290,11 +394,6 @@ int main(int argc, char* argv[]) {
       //   float pt_top2 = std::min(float(400.), jets.getTopPt2());
       //   evtwt *= sqrt(exp(0.0615-0.0005*pt_top1)*exp(0.0615-0.0005*pt_top2));
       // }
-      // b-tagging SF (only used in scaling W, I believe)
-      int nbtagged = std::min(static_cast<Float_t>(2), jets.getNbtag());
-      auto bjets = jets.getBtagJets();
-      float weight_btag( bTagEventWeight(nbtagged, bjets.at(0).getPt() ,bjets.at(0).getFlavor(), bjets.at(1).getPt(), bjets.at(1).getFlavor() ,1,0,0) );
-      if (nbtagged>2) weight_btag=0;
     }
     fout->cd();
 
@@ -344,21 +443,21 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h0_OS") -> Fill(tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
+            helper.fill2D("h0_OS", tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
           } else {
-            histos_2d->at("h0_SS") -> Fill(tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
+            helper.fill2D("h0_SS", tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
           }
         } // close if signal block
 
         if (qcdRegion) {
-          histos_2d->at("h0_QCD") -> Fill(tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
+          helper.fill2D("h0_QCD", tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
         } // close if qcd block
 
         if (wRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h0_WOS") -> Fill(tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
+            helper.fill2D("h0_WOS", tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
           } else {
-            histos_2d->at("h0_WSS") -> Fill(tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
+            helper.fill2D("h0_WSS", tau.getL2DecayMode(), (muon.getP4() + tau.getP4()).M(), evtwt);
           }
         } // close if W block
 
@@ -366,21 +465,21 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h1_OS") -> Fill(Higgs.Pt(), event.getMSV(), evtwt);
+            helper.fill2D("h1_OS", Higgs.Pt(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h1_SS") -> Fill(Higgs.Pt(), event.getMSV(), evtwt);
+            helper.fill2D("h1_SS", Higgs.Pt(), event.getMSV(), evtwt);
           }
         } // close if signal block
 
         if (qcdRegion) {
-          histos_2d->at("h1_QCD") -> Fill(Higgs.Pt(), event.getMSV(), evtwt);
+          helper.fill2D("h1_QCD", Higgs.Pt(), event.getMSV(), evtwt);
         } // close if qcd block
 
         if (wRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h1_WOS") -> Fill(Higgs.Pt(), event.getMSV(), evtwt);
+            helper.fill2D("h1_WOS", Higgs.Pt(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h1_WSS") -> Fill(Higgs.Pt(), event.getMSV(), evtwt);
+            helper.fill2D("h1_WSS", Higgs.Pt(), event.getMSV(), evtwt);
           }
         } // close if W block
 
@@ -388,21 +487,21 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h2_OS") -> Fill(jets.getDijetMass(), event.getMSV(), evtwt);
+            helper.fill2D("h2_OS", jets.getDijetMass(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h2_SS") -> Fill(jets.getDijetMass(), event.getMSV(), evtwt);
+            helper.fill2D("h2_SS", jets.getDijetMass(), event.getMSV(), evtwt);
           }
         } // close if signal block
 
         if (qcdRegion) {
-          histos_2d->at("h2_QCD") -> Fill(jets.getDijetMass(), event.getMSV(), evtwt);
+          helper.fill2D("h2_QCD", jets.getDijetMass(), event.getMSV(), evtwt);
         } // close if qcd block
 
         if (wRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h2_WOS") -> Fill(jets.getDijetMass(), event.getMSV(), evtwt);
+            helper.fill2D("h2_WOS", jets.getDijetMass(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h2_WSS") -> Fill(jets.getDijetMass(), event.getMSV(), evtwt);
+            helper.fill2D("h2_WSS", jets.getDijetMass(), event.getMSV(), evtwt);
           }
         } // close if W block
 
@@ -410,21 +509,21 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h3_OS") -> Fill(tau.getPt(), event.getMSV(), evtwt);
+            helper.fill2D("h3_OS", tau.getPt(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h3_SS") -> Fill(tau.getPt(), event.getMSV(), evtwt);
+            helper.fill2D("h3_SS", tau.getPt(), event.getMSV(), evtwt);
           }
         } // close if signal block
 
         if (qcdRegion) {
-          histos_2d->at("h3_QCD") -> Fill(tau.getPt(), event.getMSV(), evtwt);
+          helper.fill2D("h3_QCD", tau.getPt(), event.getMSV(), evtwt);
         } // close if qcd block
 
         if (wRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h3_WOS") -> Fill(tau.getPt(), event.getMSV(), evtwt);
+            helper.fill2D("h3_WOS", tau.getPt(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h3_WSS") -> Fill(tau.getPt(), event.getMSV(), evtwt);
+            helper.fill2D("h3_WSS", tau.getPt(), event.getMSV(), evtwt);
           }
         } // close if W block
 
@@ -459,8 +558,8 @@ int main(int argc, char* argv[]) {
             histos->at("Dbkg_VBF")->Fill(event.getDbkg_VBF(), evtwt);
             histos->at("Phi")->Fill(event.getPhi(), evtwt);
             histos->at("Phi1")->Fill(event.getPhi1(), evtwt);
-            histos->at("Q2V1")->Fill(event.getQ2V1(), evtwt);
-            histos->at("Q2V2")->Fill(event.getQ2V2(), evtwt);
+            helper.fill1D("Q2V1", event.getQ2V1(), evtwt);
+            helper.fill1D("Q2V2", event.getQ2V2(), evtwt);
             histos->at("costheta1")->Fill(event.getCosTheta1(), evtwt);
             histos->at("costheta2")->Fill(event.getCosTheta2(), evtwt);
             histos->at("costhetastar")->Fill(event.getCosThetaStar(), evtwt);
@@ -507,12 +606,33 @@ int main(int argc, char* argv[]) {
     } // close mt, tau selection
 
   } // close event loop
+  helper.flush();
+  io.report();
+
+  // a resumed job only filled the events after the checkpoint
+  bool resumed = first != range.getFirst();
+  if (!resumed) {
+    variations.write(histos_2d);
+    replicas.write(histos_2d);
+  } else if (weights.isEnabled() || variations.isEnabled() || replicas.isEnabled()) {
+    std::cerr << "Not writing the weight table, variations or bootstrap replicas of a resumed job" << std::endl;
+  }
   histos->at("n70")->Fill(1, n70_count);
   histos->at("n70")->Write();
 
-  fin->Close();
-  fout->cd();
-  fout->Write();
-  fout->Close();
+  // all histograms are filled, the rest of the job runs while they are written
+  writer.start();
+
+  // a partial range or a resumed job only saw part of the selected entries
+  if (range.isFull() && first == 0) {
+    cache.write();
+  }
+  if (!resumed) {
+    weights.write();
+  }
+
+  input.close();
+  writer.close();
+  ckpt.finish();
   return 0;
 }
@@ -0,0 +1,344 @@
+// system includes
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ROOT includes
+#include "TH1.h"
+#include "TH2.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TLine.h"
+#include "TStyle.h"
+#include "TColor.h"
+#include "TLatex.h"
+#include "TLegend.h"
+#include "TCanvas.h"
+#include "THStack.h"
+
+// user includes
+#include "include/CLParser.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To draw the data/MC control plots from the  //
+// merged files made by postprocess.cc, replacing       //
+// plotter.py. The variables are split into batches,    //
+// one per worker process; each worker opens every      //
+// merged file once, takes all histograms of its batch  //
+// from it and then draws a stack with a data/bkg ratio //
+// pad for every variable.                              //
+//   -v a,b,..    : histograms to plot, with their      //
+//                  directory, i.e. grabbag/el_pt       //
+//   -d DIR       : merged files (default output/)      //
+//   -o DIR       : plots, .png and .pdf (default       //
+//                  plots/)                             //
+//   -j N         : worker processes (default 1)        //
+//   --dim N      : for 2D histograms, 1 for the x and  //
+//                  2 for the y projection (default 2)  //
+//   --scale-top x: multiply the stack maximum by x     //
+//////////////////////////////////////////////////////////
+
+// merged files in the order they are stacked, bottom first
+struct plot_process {
+  std::string file, label, color;
+  enum { data, stack, signal } type;
+};
+
+const std::vector<plot_process> processes = {
+  {"data", "35.9 fb^{-1} Data", "", plot_process::data},
+  {"VV", "Diboson", "#12cadd", plot_process::stack},
+  {"ttbar", "t#bar{t}", "#9999cc", plot_process::stack},
+  {"QCD", "QCD", "#ffccff", plot_process::stack},
+  {"W", "Electroweak", "#de5a6a", plot_process::stack},
+  {"ZJ", "Z #rightarrow jet fakes", "#64c0e8", plot_process::stack},
+  {"ZL", "Z #rightarrow ll", "#4496c8", plot_process::stack},
+  {"ZTT", "Z #rightarrow #tau#tau", "#ffcc66", plot_process::stack},
+  {"ggH125", "100X ggH", "", plot_process::signal}
+};
+
+// a copy of the histogram of a variable (projected if 2D), nullptr if the file doesn't have it
+TH1* readVariable(TFile* fin, std::string variable, int dim) {
+  auto hist = (TH1*)fin->Get(variable.c_str());
+  if (!hist) {
+    return nullptr;
+  }
+  std::string name = variable.substr(variable.rfind('/') + 1);
+  auto hist_2d = dynamic_cast<TH2*>(hist);
+  if (hist_2d) {
+    hist = dim == 1 ? (TH1*)hist_2d->ProjectionX((name + "_px").c_str()) : (TH1*)hist_2d->ProjectionY((name + "_py").c_str());
+  } else {
+    hist = (TH1*)hist->Clone();
+  }
+  hist->SetDirectory(nullptr);
+  return hist;
+}
+
+void draw(std::string variable, std::vector<TH1*>& histos, std::string output_dir, double scale_top) {
+  TH1 *data(nullptr), *signal(nullptr), *stat(nullptr);
+  auto stack = new THStack();
+  auto leg = new TLegend(0.6, 0.55, 0.88, 0.88);
+  leg->SetTextSize(0.045);
+  leg->SetLineColor(0);
+  leg->SetFillColor(0);
+  std::vector<std::pair<TH1*, std::string>> entries;
+  for (size_t i = 0; i < processes.size(); i++) {
+    auto hist = histos.at(i);
+    if (!hist) {
+      continue;
+    }
+    auto& process = processes.at(i);
+    if (process.type == plot_process::data) {
+      data = hist;
+      data->SetMarkerStyle(20);
+      data->SetLineColor(kBlack);
+      data->SetFillColor(0);
+      leg->AddEntry(data, process.label.c_str(), "lep");
+    } else if (process.type == plot_process::signal) {
+      signal = hist;
+      signal->SetLineColor(kBlack);
+      signal->SetLineStyle(9);
+      signal->SetLineWidth(2);
+      signal->SetFillColor(0);
+      signal->Scale(100);
+    } else {
+      hist->SetLineColor(kBlack);
+      hist->SetFillColor(TColor::GetColor(process.color.c_str()));
+      stack->Add(hist);
+      entries.insert(entries.begin(), {hist, process.label});
+      if (!stat) {
+        stat = (TH1*)hist->Clone();
+        stat->SetDirectory(nullptr);
+      } else {
+        stat->Add(hist);
+      }
+    }
+  }
+  if (!stat) {
+    std::cerr << "No backgrounds for " << variable << std::endl;
+    delete leg;
+    delete stack;
+    return;
+  }
+  for (auto& entry : entries) {
+    leg->AddEntry(entry.first, entry.second.c_str(), "f");
+  }
+
+  auto can = new TCanvas("can", "can", 800, 600);
+  can->Draw();
+  can->Divide(1, 2);
+  auto pad1 = can->cd(1);
+  pad1->SetPad(0, .3, 1, 1);
+  pad1->SetTopMargin(.1);
+  pad1->SetBottomMargin(0.02);
+  pad1->SetTickx(1);
+  pad1->SetTicky(1);
+  auto pad2 = can->cd(2);
+  pad2->SetPad(0, 0, 1, .3);
+  pad2->SetTopMargin(0.06);
+  pad2->SetBottomMargin(0.35);
+  pad2->SetTickx(1);
+  pad2->SetTicky(1);
+  can->cd(1);
+
+  stack->Draw("hist");
+  stack->GetXaxis()->SetLabelSize(0);
+  stack->GetYaxis()->SetTitle("Events / Bin");
+  stack->GetYaxis()->SetTitleFont(42);
+  stack->GetYaxis()->SetTitleSize(.05);
+  stack->GetYaxis()->SetTitleOffset(.92);
+  stack->SetMaximum(stack->GetMaximum() * scale_top);
+  stack->SetMinimum(1);
+  stat->SetMarkerStyle(0);
+  stat->SetLineWidth(2);
+  stat->SetLineColor(0);
+  stat->SetFillStyle(3004);
+  stat->SetFillColor(kBlack);
+  if (signal) {
+    signal->Draw("hist same");
+  }
+  if (data) {
+    data->Draw("same lep");
+  }
+  stat->Draw("same e2");
+  leg->Draw();
+
+  TLatex lumi;
+  lumi.SetNDC(kTRUE);
+  lumi.SetTextSize(0.06);
+  lumi.SetTextFont(42);
+  lumi.DrawLatex(0.69, 0.92, "35.9 fb^{-1} (13 TeV)");
+  TLatex cms;
+  cms.SetNDC(kTRUE);
+  cms.SetTextFont(61);
+  cms.SetTextSize(0.1);
+  cms.DrawLatex(0.14, 0.75, "CMS");
+  TLatex prel;
+  prel.SetNDC(kTRUE);
+  prel.SetTextFont(52);
+  prel.SetTextSize(0.1);
+  prel.DrawLatex(0.25, 0.75, "Preliminary");
+
+  // data / bkg with the stat. uncertainty of the backgrounds around 1
+  can->cd(2);
+  auto den = (TH1*)stat->Clone();
+  den->Divide(stat);
+  den->SetMaximum(1.4);
+  den->SetMinimum(0.6);
+  auto ratio = data ? (TH1*)data->Clone() : (TH1*)den->Clone();
+  if (data) {
+    ratio->Divide(stat);
+  }
+  ratio->SetTitle("");
+  ratio->SetMaximum(1.4);
+  ratio->SetMinimum(0.6);
+  ratio->SetFillColor(0);
+  ratio->SetLineColor(kBlack);
+  ratio->GetXaxis()->SetTitle(stat->GetXaxis()->GetTitle());
+  ratio->GetXaxis()->SetTitleSize(0.15);
+  ratio->GetXaxis()->SetTitleOffset(0.8);
+  ratio->GetXaxis()->SetLabelFont(42);
+  ratio->GetXaxis()->SetLabelSize(.1);
+  ratio->GetYaxis()->SetTitle("#frac{Data}{Bkg.}");
+  ratio->GetYaxis()->SetTitleSize(0.14);
+  ratio->GetYaxis()->SetTitleFont(42);
+  ratio->GetYaxis()->SetTitleOffset(.31);
+  ratio->GetYaxis()->SetLabelSize(.1);
+  ratio->GetYaxis()->SetNdivisions(505);
+  ratio->Draw("lep2");
+  den->Draw("e2same");
+  ratio->Draw("same lep2");
+
+  double low = ratio->GetXaxis()->GetXmin();
+  double high = ratio->GetXaxis()->GetXmax();
+  std::vector<TLine*> lines = {new TLine(low, 1.4, high, 1.4), new TLine(low, 0.6, high, 0.6), new TLine(low, 1, high, 1)};
+  for (auto line : lines) {
+    line->SetLineWidth(1);
+    line->SetLineStyle(7);
+    line->SetLineColor(kBlack);
+    line->Draw("same");
+  }
+
+  std::string name = variable;
+  std::replace(name.begin(), name.end(), '/', '_');
+  can->SaveAs((output_dir + name + ".png").c_str());
+  can->SaveAs((output_dir + name + ".pdf").c_str());
+
+  for (auto line : lines) {
+    delete line;
+  }
+  delete can;
+  delete leg;
+  delete stack;
+  delete stat;
+  delete den;
+  delete ratio;
+}
+
+// read every file once for the whole batch, then draw it
+int plotBatch(std::vector<std::string> variables, std::string input_dir, std::string output_dir, int dim, double scale_top) {
+  // [variable][process]
+  std::vector<std::vector<TH1*>> histos(variables.size(), std::vector<TH1*>(processes.size(), nullptr));
+  for (size_t i = 0; i < processes.size(); i++) {
+    std::string fname = input_dir + processes.at(i).file + ".root";
+    auto fin = TFile::Open(fname.c_str(), "READ");
+    if (!fin || fin->IsZombie()) {
+      std::cerr << "Unable to read " << fname << ", leaving it out" << std::endl;
+      continue;
+    }
+    for (size_t j = 0; j < variables.size(); j++) {
+      histos.at(j).at(i) = readVariable(fin, variables.at(j), dim);
+    }
+    fin->Close();
+    delete fin;
+  }
+
+  int nfailed(0);
+  for (size_t j = 0; j < variables.size(); j++) {
+    bool found(false);
+    for (auto hist : histos.at(j)) {
+      found = found || hist;
+    }
+    if (!found) {
+      std::cerr << "No " << variables.at(j) << " in any file" << std::endl;
+      nfailed++;
+      continue;
+    }
+    draw(variables.at(j), histos.at(j), output_dir, scale_top);
+    for (auto hist : histos.at(j)) {
+      delete hist;
+    }
+  }
+  return nfailed;
+}
+
+int main(int argc, char* argv[]) {
+  CLParser parser(argc, argv);
+  std::string variable_list = parser.Option("-v");
+  std::string input_dir = parser.Option("-d");
+  std::string output_dir = parser.Option("-o");
+  std::string workers = parser.Option("-j");
+  std::string dim_opt = parser.Option("--dim");
+  std::string scale_opt = parser.Option("--scale-top");
+  input_dir = input_dir.empty() ? "output/" : input_dir + "/";
+  output_dir = output_dir.empty() ? "plots/" : output_dir + "/";
+  int nworkers = workers.empty() ? 1 : std::max(1, std::stoi(workers));
+  int dim = dim_opt.empty() ? 2 : std::stoi(dim_opt);
+  double scale_top = scale_opt.empty() ? 1. : std::stod(scale_opt);
+
+  std::vector<std::string> variables;
+  std::stringstream ss(variable_list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    variables.push_back(item);
+  }
+  if (variables.empty()) {
+    std::cerr << "Give the histograms to plot with -v, i.e. -v grabbag/el_pt,grabbag/met" << std::endl;
+    return 1;
+  }
+  nworkers = std::min(nworkers, static_cast<int>(variables.size()));
+
+  gROOT->SetBatch(kTRUE);
+  gStyle->SetOptStat(0);
+  TH1::AddDirectory(false);
+
+  // round robin, so plots of one directory are spread over the workers
+  std::vector<std::vector<std::string>> batches(nworkers);
+  for (size_t i = 0; i < variables.size(); i++) {
+    batches.at(i % nworkers).push_back(variables.at(i));
+  }
+  if (nworkers == 1) {
+    return plotBatch(batches.front(), input_dir, output_dir, dim, scale_top) > 0 ? 1 : 0;
+  }
+
+  std::vector<pid_t> children;
+  for (auto& batch : batches) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      _exit(plotBatch(batch, input_dir, output_dir, dim, scale_top) > 0 ? 1 : 0);
+    } else if (pid < 0) {
+      std::cerr << "Unable to start a worker, plotting its batch here" << std::endl;
+      plotBatch(batch, input_dir, output_dir, dim, scale_top);
+    } else {
+      children.push_back(pid);
+    }
+  }
+
+  int nfailed(0);
+  for (auto pid : children) {
+    int status(0);
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      nfailed++;
+    }
+  }
+  std::cout << "Plotted " << variables.size() << " variables with " << nworkers << " workers";
+  if (nfailed > 0) {
+    std::cout << ", " << nfailed << " workers had missing histograms";
+  }
+  std::cout << std::endl;
+  return nfailed > 0 ? 1 : 0;
+}
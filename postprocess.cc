@@ -0,0 +1,79 @@
+// system includes
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ROOT includes
+#include "TH1.h"
+#include "TFile.h"
+
+// user includes
+#include "include/CLParser.h"
+#include "include/merged_output.h"
+#include "include/qcd_estimate.h"
+#include "include/w_normalization.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To merge the analyzer outputs and make the  //
+// data-driven backgrounds in one pass. All outputs are //
+// read once into memory, merged by inputs/merge.txt,   //
+// W+jets is normalized in the high mT region, the QCD  //
+// estimate is made from the merged histograms and      //
+// every merged file, plus QCD.root, is written at the  //
+// end.                                                 //
+//   -d DIR     : directory of the analyzer outputs,    //
+//                also used for the merged files        //
+//                (default output/)                     //
+//   -t FILE    : merge table (default                  //
+//                inputs/merge.txt)                     //
+//   --data G   : data group (default data)             //
+//   --w G      : W+jets group (default W)              //
+//   --no-w     : leave W+jets unscaled                 //
+//   --no-qcd   : no QCD estimate                       //
+//////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+  CLParser parser(argc, argv);
+  std::string dir = parser.Option("-d");
+  std::string table = parser.Option("-t");
+  std::string data = parser.Option("--data");
+  std::string wjets = parser.Option("--w");
+  if (dir.empty()) {
+    dir = "output/";
+  } else if (dir.back() != '/') {
+    dir += "/";
+  }
+  if (table.empty()) {
+    table = "inputs/merge.txt";
+  }
+  if (data.empty()) {
+    data = "data";
+  }
+  if (wjets.empty()) {
+    wjets = "W";
+  }
+
+  // keep the merged histograms out of the input files
+  TH1::AddDirectory(false);
+
+  merged_output merged(table, dir);
+  if (!merged.isValid() || !merged.read()) {
+    return 1;
+  }
+
+  // before the QCD estimate, which subtracts the normalized W+jets
+  if (!parser.Flag("--no-w")) {
+    w_normalization normalization(&merged, data, wjets);
+    if (normalization.measure()) {
+      normalization.apply();
+    }
+  }
+
+  if (!parser.Flag("--no-qcd")) {
+    qcd_estimate qcd(&merged, data, "QCD");
+    qcd.estimate();
+  }
+
+  merged.write(dir);
+  return 0;
+}
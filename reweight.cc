@@ -0,0 +1,196 @@
+// system includes
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+// ROOT includes
+#include "TH2F.h"
+#include "TFile.h"
+#include "TArrayD.h"
+#include "TDirectory.h"
+
+// user includes
+#include "include/CLParser.h"
+#include "include/weight_table.h"
+
+//////////////////////////////////////////////////////////
+// Purpose: To rebuild the 2D templates of an analyzer  //
+// job from the weight table it wrote with --weights,   //
+// with some weight factors dropped or scaled.          //
+//   -w FILE        : weight table (<output>.weights)   //
+//   -i FILE        : output of the same job, used for  //
+//                    the binning of each histogram     //
+//   -o FILE        : new output (<output>_reweighted)  //
+//   --drop A,B     : set the factors A, B to 1         //
+//   --scale A=x    : multiply factor A by x, i.e.      //
+//                    --scale zmm=1.02,trigger=0.98     //
+// Without --drop or --scale the templates of the input //
+// are reproduced, which is checked and printed.        //
+//////////////////////////////////////////////////////////
+
+// index of a factor name, -1 if unknown
+int findComponent(std::string name) {
+  for (int i = 0; i < weight_table::n_components; i++) {
+    if (name == weight_table::names[i]) {
+      return i;
+    }
+  }
+  std::cerr << "Unknown weight factor " << name << ", choose from:";
+  for (int i = 0; i < weight_table::n_components; i++) {
+    std::cerr << " " << weight_table::names[i];
+  }
+  std::cerr << std::endl;
+  return -1;
+}
+
+int main(int argc, char* argv[]) {
+  CLParser parser(argc, argv);
+  std::string weight_name = parser.Option("-w");
+  std::string input_name = parser.Option("-i");
+  std::string output_name = parser.Option("-o");
+  std::string drop = parser.Option("--drop");
+  std::string scale = parser.Option("--scale");
+  if (output_name.empty()) {
+    output_name = input_name.substr(0, input_name.rfind(".root")) + "_reweighted.root";
+  }
+
+  // dropped factors are left out of the product, scaled ones multiplied
+  std::vector<double> factors(weight_table::n_components, 1.);
+  std::vector<bool> dropped(weight_table::n_components, false);
+  std::stringstream ss_drop(drop);
+  std::string item;
+  while (std::getline(ss_drop, item, ',')) {
+    int comp = findComponent(item);
+    if (comp < 0) {
+      return 1;
+    }
+    dropped.at(comp) = true;
+  }
+  std::stringstream ss_scale(scale);
+  while (std::getline(ss_scale, item, ',')) {
+    auto equals = item.find('=');
+    int comp = findComponent(item.substr(0, equals));
+    if (comp < 0 || equals == std::string::npos) {
+      return 1;
+    }
+    factors.at(comp) *= std::stod(item.substr(equals + 1));
+  }
+  bool unchanged = drop.empty() && scale.empty();
+
+  // read the whole table
+  auto fwgt = fopen(weight_name.c_str(), "rb");
+  weight_header header;
+  if (!fwgt || fread(&header, sizeof(header), 1, fwgt) != 1 || std::memcmp(header.magic, weight_table::magic, 8) != 0) {
+    std::cerr << "Unable to read weight table " << weight_name << std::endl;
+    return 1;
+  }
+  std::vector<std::string> components, keys;
+  std::string name;
+  for (Long64_t i = 0; i < header.ncomponents + header.nkeys; i++) {
+    if (!weight_table::readName(fwgt, name)) {
+      std::cerr << "Unable to read weight table " << weight_name << std::endl;
+      return 1;
+    }
+    (i < header.ncomponents ? components : keys).push_back(name);
+  }
+  if (header.ncomponents != weight_table::n_components) {
+    std::cerr << weight_name << " was written with different weight factors" << std::endl;
+    return 1;
+  }
+  std::vector<float> events(header.nevents * header.ncomponents);
+  std::vector<weight_fill> fills(header.nfills);
+  if (fread(events.data(), sizeof(float), events.size(), fwgt) != events.size() ||
+      fread(fills.data(), sizeof(weight_fill), fills.size(), fwgt) != fills.size()) {
+    std::cerr << "Unable to read weight table " << weight_name << std::endl;
+    return 1;
+  }
+  fclose(fwgt);
+
+  // the new weight of each event
+  std::vector<double> weights(header.nevents);
+  for (Long64_t evt = 0; evt < header.nevents; evt++) {
+    double weight(1.);
+    for (int comp = 0; comp < weight_table::n_components; comp++) {
+      if (!dropped.at(comp)) {
+        weight *= events.at(evt * header.ncomponents + comp) * factors.at(comp);
+      }
+    }
+    weights.at(evt) = weight;
+  }
+
+  // empty copies of the recorded histograms, in the same directories
+  auto fin = TFile::Open(input_name.c_str());
+  if (!fin || fin->IsZombie()) {
+    std::cerr << "Unable to open " << input_name << std::endl;
+    return 1;
+  }
+  auto fout = new TFile(output_name.c_str(), "RECREATE");
+  std::vector<TH2F*> originals, hists;
+  for (auto& key : keys) {
+    auto original = (TH2F*)fin->Get(key.c_str());
+    if (!original) {
+      std::cerr << "No histogram " << key << " in " << input_name << std::endl;
+      return 1;
+    }
+    std::string dir = key.substr(0, key.find('/'));
+    if (!fout->GetDirectory(dir.c_str())) {
+      fout->mkdir(dir.c_str());
+    }
+    fout->cd(dir.c_str());
+    auto hist = (TH2F*)original->Clone();
+    hist->Reset();
+    hist->SetDirectory(gDirectory);
+    originals.push_back(original);
+    hists.push_back(hist);
+  }
+
+  // fill straight into the bins
+  std::vector<Long64_t> entries(keys.size(), 0);
+  for (auto& fill : fills) {
+    auto hist = hists.at(fill.key);
+    double weight = weights.at(fill.event);
+    hist->AddBinContent(fill.bin, weight);
+    if (hist->GetSumw2N() > 0) {
+      hist->GetSumw2()->fArray[fill.bin] += weight * weight;
+    }
+    entries.at(fill.key)++;
+  }
+
+  std::cout << "Rebuilt " << keys.size() << " histograms from " << header.nevents << " events:" << std::endl;
+  double largest_difference(0.);
+  for (size_t i = 0; i < hists.size(); i++) {
+    hists.at(i)->ResetStats();
+    hists.at(i)->SetEntries(entries.at(i));
+    std::cout << "  " << keys.at(i) << ": " << originals.at(i)->Integral() << " -> " << hists.at(i)->Integral() << std::endl;
+    for (int bin = 0; bin < hists.at(i)->GetNcells(); bin++) {
+      double before = originals.at(i)->GetBinContent(bin);
+      double after = hists.at(i)->GetBinContent(bin);
+      if (before != 0.) {
+        largest_difference = std::max(largest_difference, std::fabs(after / before - 1.));
+      } else if (after != 0.) {
+        largest_difference = std::max(largest_difference, 1.);
+      }
+    }
+  }
+
+  // float factors keep about 7 digits
+  if (unchanged) {
+    if (largest_difference > 1e-4) {
+      std::cerr << "Rebuilt templates differ from " << input_name << " by up to " << largest_difference * 100
+                << "%, the weight table does not belong to this output" << std::endl;
+    } else {
+      std::cout << "Rebuilt templates agree with " << input_name << std::endl;
+    }
+  }
+
+  fout->Write();
+  fout->Close();
+  fin->Close();
+  std::cout << "Wrote " << output_name << std::endl;
+  return 0;
+}
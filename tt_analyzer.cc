@@ -17,6 +17,14 @@
 #include "RooMsgService.h"
 
 // user includes
+#include "include/sample_table.h"
+#include "include/lazy_histos.h"
+#include "include/weight_table.h"
+#include "include/weight_variations.h"
+#include "include/bootstrap.h"
+#include "include/fast_hist.h"
+#include "include/zpt_table.h"
+#include "include/nnlops.h"
 #include "include/util.h"
 #include "include/event_info.h"
 #include "include/ditau_factory.h"
@@ -26,8 +34,19 @@
 #include "include/SF_factory.h"
 #include "include/tauSF.h"
 #include "include/btagSF.h"
+#include "include/btag_weights.h"
 #include "include/LumiReweightingStandAlone.h"
 #include "include/CLParser.h"
+#include "include/skim_cache.h"
+#include "include/stitching.h"
+#include "include/input_chain.h"
+#include "include/event_index.h"
+#include "include/event_range.h"
+#include "include/checkpoint.h"
+#include "include/tree_io.h"
+#include "include/column_file.h"
+#include "include/event_pipeline.h"
+#include "include/output_writer.h"
 
 int main(int argc, char* argv[]) {
 
@@ -43,46 +62,83 @@ int main(int argc, char* argv[]) {
   std::string path = parser.Option("-p");
   std::string syst = parser.Option("-u");
   std::string postfix = parser.Option("-P");
-  std::string fname = path + sample + postfix;
-  bool isData = sample.find("Data") != std::string::npos;
-  // bool isData = parser.Flag("-d");
+  bool use_cache = parser.Flag("-c");
+  std::string checkpoint_every = parser.Option("--checkpoint");
+
+  // data/MC, cross sections and stitching come from inputs/samples.txt (sample_table.h)
+  if (!sample_table::get().check(sample, name)) {
+    return 1;
+  }
+  bool isData = sample_table::get().isData(sample);
+
   std::string systname = "";
   if (!syst.empty()) {
     systname = "_" + syst;
   }
 
-  // open input file
-  std::cout << "Opening file... " << sample << std::endl;
-  auto fin = TFile::Open(fname.c_str());
-  std::cout << "Loading Ntuple..." << std::endl;
-  auto ntuple = (TTree*)fin->Get("tt_tree");
+  // open input files, several samples are read as one chain (input_chain.h)
+  tree_io::configure(parser);
+  input_chain input(sample, path, postfix, "tt_tree");
+  if (!input.isValid()) {
+    return 1;
+  }
+  auto ntuple = input.getTree();
+
+  // outputs of several samples are named after the process
+  if (input.getNFiles() > 1) {
+    sample = name;
+  }
+
+  // run/lumi/evt index for lumi masks, duplicates and single events (event_index.h)
+  event_index index(parser, input.getFileNames(), ntuple->GetName());
+  if (!index.isValid()) {
+    return 1;
+  }
 
-  // get number of generated events
-  auto counts = (TH1D*)fin->Get("nevents");
-  auto gen_number = counts->GetBinContent(2);
+  // entries passing the event selection from a previous run (skim_cache.h), keyed by
+  // every parameter the cuts before cache.record read. Bump the version whenever
+  // the code of those cuts changes
+  selection_config selection("tt", 1);
+  selection.add("tree", std::string(ntuple->GetName()));
+  selection.add("process", name);
+  selection.add("index", index.getKey());
+  const double tau_eta_max = selection.add("tau_eta_max", 2.1);
+  skim_cache cache(use_cache && !index.isSingleEvent(), "tt", sample + "_" + name, input.getID(), selection.getKey());
+
+  // block of entries handled by this job (event_range.h)
+  event_range range(parser, cache.getN(ntuple->GetEntries()));
+  if (!range.isValid()) {
+    return 1;
+  }
+  if (index.isSingleEvent()) {
+    range.select(index.getSelected(), index.getLabel());
+  }
 
   // create output file
   auto suffix = "_output.root";
   auto prefix = "output/";
   std::string filename;
   if (name == sample) {
-    filename = prefix + name + systname + suffix;
+    filename = prefix + name + systname + range.getLabel() + suffix;
   } else {
-    filename = prefix + sample + std::string("_") + name + systname + suffix;
+    filename = prefix + sample + std::string("_") + name + systname + range.getLabel() + suffix;
   }
-  auto fout = new TFile(filename.c_str(), "RECREATE");
+  // written on several threads and with the chosen compression (output_writer.h)
+  output_writer writer(parser, filename);
+  if (!writer.isValid()) {
+    return 1;
+  }
+  auto fout = writer.open();
   fout->mkdir("grabbag");
   fout->cd("grabbag");
 
   // initialize Helper class
   Helper helper(fout, name, syst);
 
-  // get normalization (lumi & xs are in util.h)
-  double norm;
-  if (isData)
-    norm = 1.0;
-  else
-    norm = helper.getLuminosity() * helper.getCrossSection(sample) / gen_number;
+  // get normalization of each input file (lumi & xs are in util.h)
+  // and the jet-multiplicity weights of stitched W and DY samples
+  stitching stitch(input.getSamples(), path, postfix, helper);
+  input.normalize(helper, isData, stitch);
 
   ///////////////////////////////////////////////
   // Scale Factors:                            //
@@ -96,8 +152,14 @@ int main(int argc, char* argv[]) {
   TFile *f_Trk = new TFile("inputs/etracking.root");
 
   // Z-pT reweighting
-  TFile *zpt_file = new TFile("inputs/zpt_weights_2016_BtoH.root");
-  auto zpt_hist = (TH2F*)zpt_file->Get("zptmass_histo");
+  zpt_table::range_policy zpt_range;
+  if (!zpt_table::readPolicy(parser.Option("--zpt-range"), zpt_range)) {
+    return 1;
+  }
+  zpt_table zpt_weights("inputs/zpt_weights_2016_BtoH.root", "zptmass_histo", zpt_range);
+  if (!zpt_weights.isValid()) {
+    return 1;
+  }
 
   //H->tau tau scale factors
   // TFile htt_sf_file("inputs/htt_scalefactors_v16_3.root");
@@ -107,11 +169,23 @@ int main(int argc, char* argv[]) {
   // trigger and ID scale factors
   auto tauSFs = tauSF();
 
-  TFile * f_NNLOPS = new TFile("inputs/NNLOPS_reweight.root");
-  TGraph * g_NNLOPS_0jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_0jet");
-  TGraph * g_NNLOPS_1jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_1jet");
-  TGraph * g_NNLOPS_2jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_2jet");
-  TGraph * g_NNLOPS_3jet = (TGraph*) f_NNLOPS-> Get("gr_NNLOPSratio_pt_powheg_3jet");
+  // NNLOPS reweighting of ggH
+  nnlops nnlops_weights("inputs/NNLOPS_reweight.root", 0.5, parser.Flag("--nnlops-check"));
+  if (!nnlops_weights.isValid()) {
+    return 1;
+  }
+  if (parser.Flag("--nnlops-check")) {
+    nnlops_weights.check(10000);
+  }
+
+  // compare the b-tag event weight tables to the brute force sum with GetSF (btag_weights.h)
+  if (parser.Flag("--btag-check")) {
+    btag_weights btag(1, 0.5, 1000.);
+    if (!btag.isValid()) {
+      return 1;
+    }
+    btag.check(10000);
+  }
 
   //////////////////////////////////////
   // Final setup:                     //
@@ -128,44 +202,58 @@ int main(int argc, char* argv[]) {
   ditau_factory    ditaus(ntuple);
   jet_factory      jets(ntuple, syst);
   met_factory      met(ntuple, syst);
-  double n70_count;
+  double n70_count(0.);
+
+  // only read the branches bound above, through a tuned cache (tree_io.h)
+  tree_io io(ntuple, parser);
+  if (range.getLast() > range.getFirst()) {
+    io.setup(cache.getEntry(range.getFirst()), cache.getEntry(range.getLast() - 1) + 1);
+  }
+
+  // read entries from a memory-mapped column file if one is given (column_file.h)
+  column_reader columns(parser, input.getFile(0));
+  columns.bind(ntuple);
+
+  // periodically save histograms so an interrupted job can resume (checkpoint.h)
+  std::string job_key = input.getName() + range.getLabel() + (cache.isValid() ? cache.getName() : "");
+  checkpoint ckpt(filename, job_key, checkpoint_every.empty() ? 0 : std::stoll(checkpoint_every), histos, histos_2d);
+  ckpt.setBeforeWrite([&helper]() { helper.flush(); });
+
+  // keep the weight factors of every filled event for reweight.cc (weight_table.h)
+  weight_table weights(parser.Flag("--weights"), filename.substr(0, filename.rfind(".root")) + ".weights");
+  helper.setRecorder(&weights);
+
+  // fill the Zmm SF up/down and trigger SF shapes together with the nominal (weight_variations.h)
+  weight_variations variations(parser.Flag("--variations") && !isData, {"_CMS_htt_zmumuShape_13TeVUp", "_CMS_htt_zmumuShape_13TeVDown",
+                                                                        "_trig_RR", "_trig_RF", "_trig_FR", "_trig_FF"});
+  helper.setVariations(&variations);
+
+  // fill Poisson bootstrap replicas of the signal-region templates (bootstrap.h)
+  std::string bootstrap_replicas = parser.Option("--bootstrap");
+  bootstrap replicas(bootstrap_replicas.empty() ? 0 : std::stoi(bootstrap_replicas));
+  helper.setReplicas(&replicas);
 
   // begin the event loop
-  Int_t nevts = ntuple->GetEntries();
-  for (Int_t i = 0; i < nevts; i++) {
-    ntuple->GetEntry(i);
+  Long64_t first = ckpt.restore(range.getFirst());
+  Long64_t nevts = range.getLast();
+
+  // read entries here or on a separate thread (event_pipeline.h)
+  event_pipeline reader(ntuple, input.getFileNames(), ntuple->GetName(), &cache, &columns, first, nevts, parser);
+  for (Long64_t i = first; i < nevts; i++) {
+    ckpt.update(i);
+    Long64_t entry = reader.load(i);
+    if (!index.accept(entry)) {
+      continue;
+    }
     if (i % 100000 == 0)
       std::cout << "Processing event: " << i << " out of " << nevts << std::endl;
 
     // find the event weight (not lumi*xs if looking at W or Drell-Yan)
-    double evtwt(norm), corrections(1.), sf_trig1(1.), sf_trig2(1.);
+    double evtwt(input.getWeight(entry, event.getNumGenJets())), corrections(1.), sf_trig1(1.), sf_trig2(1.);
     double sf_trig_RR(1.), sf_trig_RF(1.), sf_trig_FR(1.), sf_trig_FF(1.);
-
-    if (name == "W") {
-      if (event.getNumGenJets() == 1)
-        evtwt = 6.8176;
-      else if (event.getNumGenJets() == 2)
-        evtwt = 2.1038;
-      else if (event.getNumGenJets() == 3)
-        evtwt = 0.6889;
-      else if (event.getNumGenJets() == 4)
-        evtwt = 0.6900;
-      else
-        evtwt = 25.446;
-    }
-
-    if (name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
-      if (event.getNumGenJets() == 1)
-        evtwt = 0.457675455;
-      else if (event.getNumGenJets() == 2)
-        evtwt = 0.467159142;
-      else if (event.getNumGenJets() == 3)
-        evtwt = 0.480349711;
-      else if (event.getNumGenJets() == 4)
-        evtwt = 0.3938184351;
-      else
-        evtwt = 1.41957039;
-    }
+    weights.start(evtwt);
+    variations.start();
+    replicas.start(event.getRun(), event.getLumi(), event.getEvt());
 
     histos->at("cutflow")->Fill(1., 1.);
 
@@ -190,7 +278,7 @@ int main(int argc, char* argv[]) {
     else continue;
 
     // |eta| < 2.1
-    if (fabs(tau1.getEta()) < 2.1 && fabs(tau2.getEta()) < 2.1) histos->at("cutflow")->Fill(4, 1.);
+    if (fabs(tau1.getEta()) < tau_eta_max && fabs(tau2.getEta()) < tau_eta_max) histos->at("cutflow")->Fill(4, 1.);
     else continue;
 
     // dR(t1, t2) selection
@@ -219,6 +307,7 @@ int main(int argc, char* argv[]) {
     }
 
     histos->at("cutflow") -> Fill(6., 1.);
+    cache.record(entry);
 
     // apply all scale factors/corrections/etc.
     if (!isData) {
@@ -226,7 +315,9 @@ int main(int argc, char* argv[]) {
       // apply trigger and id SF's
       sf_trig1 = tauSFs.compute_SF(tau1.getPt(), std::to_string(int(tau1.getDecayMode())));
       sf_trig2 = tauSFs.compute_SF(tau1.getPt(), std::to_string(int(tau2.getDecayMode())));
-      evtwt *= (sf_trig1 * sf_trig2 * lumi_weights->weight(event.getNPU()) * event.getGenWeight());
+      evtwt *= weights.apply(weight_table::trigger, sf_trig1 * sf_trig2);
+      evtwt *= weights.apply(weight_table::pileup, lumi_weights->weight(event.getNPU()));
+      evtwt *= weights.apply(weight_table::genweight, event.getGenWeight());
 
       // for trigger SF systematics
       if (tau1.getGenMatch() == 5) {
@@ -243,13 +334,17 @@ int main(int argc, char* argv[]) {
         sf_trig_FF *= sf_trig2;
         sf_trig_FR *= sf_trig2;
       }
+      variations.set(2, sf_trig_RR, sf_trig1 * sf_trig2);
+      variations.set(3, sf_trig_RF, sf_trig1 * sf_trig2);
+      variations.set(4, sf_trig_FR, sf_trig1 * sf_trig2);
+      variations.set(5, sf_trig_FF, sf_trig1 * sf_trig2);
 
       // tau ID efficiency SF
       if (tau1.getGenMatch() == 5) {
-        evtwt *= 0.95;
+        evtwt *= weights.apply(weight_table::tau_id, 0.95);
       }
       if (tau2.getGenMatch() == 5) {
-        evtwt *= 0.95;
+        evtwt *= weights.apply(weight_table::tau_id, 0.95);
       }
 
       // htt_sf->var("e_pt")->setVal(electron.getPt());
@@ -257,26 +352,25 @@ int main(int argc, char* argv[]) {
       // evtwt *= htt_sf->function("e_trk_ratio")->getVal();
 
       // // anti-lepton discriminator SFs
-      evtwt *= tauSFs.tauID_SF(tau1.getGenMatch(), tau1.getEta());
-      evtwt *= tauSFs.tauID_SF(tau2.getGenMatch(), tau2.getEta());
+      evtwt *= weights.apply(weight_table::antilepton, tauSFs.tauID_SF(tau1.getGenMatch(), tau1.getEta()));
+      evtwt *= weights.apply(weight_table::antilepton, tauSFs.tauID_SF(tau2.getGenMatch(), tau2.getEta()));
+
+      // NNLOPS reweighting of the POWHEG ggH samples
+      if (name.find("ggH") == 0) {
+        evtwt *= weights.apply(weight_table::nnlops, nnlops_weights.weight(int(event.getNumGenJets()), event.getGenPt()));
+      }
 
       // Z-pT and Zmm Reweighting
       if (name=="EWKZLL" || name=="EWKZNuNu" || name=="ZTT" || name=="ZLL" || name=="ZL" || name=="ZJ") {
-        evtwt *= zpt_hist->GetBinContent(zpt_hist->GetXaxis()->FindBin(event.getGenM()),zpt_hist->GetYaxis()->FindBin(event.getGenPt()));
+        evtwt *= weights.apply(weight_table::zpt, zpt_weights.weight(event.getGenM(), event.getGenPt()));
       } 
 
       // top-pT Reweighting (only for some systematic)
       if (name == "TTT" || name == "TT" || name == "TTJ") {
         float pt_top1 = std::min(float(400.), jets.getTopPt1());
         float pt_top2 = std::min(float(400.), jets.getTopPt2());
-        evtwt *= sqrt(exp(0.0615-0.0005*pt_top1)*exp(0.0615-0.0005*pt_top2));
+        evtwt *= weights.apply(weight_table::toppt, sqrt(exp(0.0615-0.0005*pt_top1)*exp(0.0615-0.0005*pt_top2)));
       }
-
-      // b-tagging SF (only used in scaling W, I believe)
-      int nbtagged = std::min(2, jets.getNbtag());
-      auto bjets = jets.getBtagJets();
-      float weight_btag( bTagEventWeight(nbtagged, bjets.at(0).getPt() ,bjets.at(0).getFlavor(), bjets.at(1).getPt(), bjets.at(1).getFlavor() ,1,0,0) );
-      if (nbtagged>2) weight_btag=0;
     }
     fout->cd();
 
@@ -304,9 +398,15 @@ int main(int argc, char* argv[]) {
 
     if (name == "EWKZLL" || name == "EWKZNuNu" || name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ") {
       if (boosted) {
-        evtwt *= tauSFs.boosted_ZmmSF(event.getPtSV(), syst);
+        double sf_zmm = tauSFs.boosted_ZmmSF(event.getPtSV(), syst);
+        evtwt *= weights.apply(weight_table::zmm, sf_zmm);
+        variations.set(0, tauSFs.boosted_ZmmSF(event.getPtSV(), "ZmmSF_Up"), sf_zmm);
+        variations.set(1, tauSFs.boosted_ZmmSF(event.getPtSV(), "ZmmSF_Down"), sf_zmm);
       } else if (vbfCat) {
-        evtwt *= tauSFs.VBF_ZmmSF(jets.getDijetMass(), syst);
+        double sf_zmm = tauSFs.VBF_ZmmSF(jets.getDijetMass(), syst);
+        evtwt *= weights.apply(weight_table::zmm, sf_zmm);
+        variations.set(0, tauSFs.VBF_ZmmSF(jets.getDijetMass(), "ZmmSF_Up"), sf_zmm);
+        variations.set(1, tauSFs.VBF_ZmmSF(jets.getDijetMass(), "ZmmSF_Down"), sf_zmm);
       }
     }
 
@@ -317,9 +417,9 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h0_OS")->Fill(event.getMSV(), 1., evtwt);
+            helper.fill2D("h0_OS", event.getMSV(), 1., evtwt);
           } else {
-            histos_2d->at("h0_SS")->Fill(event.getMSV(), 1., evtwt);
+            helper.fill2D("h0_SS", event.getMSV(), 1., evtwt);
           }
         } // close if signal block
 
@@ -327,9 +427,9 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h1_OS")->Fill(event.getPtSV(), event.getMSV(), evtwt);
+            helper.fill2D("h1_OS", event.getPtSV(), event.getMSV(), evtwt);
           } else {
-            histos_2d->at("h1_SS")->Fill(event.getPtSV(), event.getMSV(), evtwt);
+            helper.fill2D("h1_SS", event.getPtSV(), event.getMSV(), evtwt);
           }
         } // close if signal block
 
@@ -337,9 +437,9 @@ int main(int argc, char* argv[]) {
 
         if (signalRegion) {
           if (evt_charge == 0) {
-            histos_2d->at("h2_OS")->Fill(normMELA, 1., evtwt);
+            helper.fill2D("h2_OS", normMELA, 1., evtwt);
           } else {
-            histos_2d->at("h2_SS")->Fill(normMELA, 1., evtwt);
+            helper.fill2D("h2_SS", normMELA, 1., evtwt);
           }
         } // close if signal block
 
@@ -348,13 +448,33 @@ int main(int argc, char* argv[]) {
     } // close tau selection
     histos->at("cutflow")->Fill(7., 1.);
   } // close event loop
-
+  helper.flush();
+  io.report();
+
+  // a resumed job only filled the events after the checkpoint
+  bool resumed = first != range.getFirst();
+  if (!resumed) {
+    variations.write(histos_2d);
+    replicas.write(histos_2d);
+  } else if (weights.isEnabled() || variations.isEnabled() || replicas.isEnabled()) {
+    std::cerr << "Not writing the weight table, variations or bootstrap replicas of a resumed job" << std::endl;
+  }
   histos->at("n70")->Fill(1, n70_count);
   histos->at("n70")->Write();
 
-  fin->Close();
-  fout->cd();
-  fout->Write();
-  fout->Close();
+  // all histograms are filled, the rest of the job runs while they are written
+  writer.start();
+
+  // a partial range or a resumed job only saw part of the selected entries
+  if (range.isFull() && first == 0) {
+    cache.write();
+  }
+  if (!resumed) {
+    weights.write();
+  }
+
+  input.close();
+  writer.close();
+  ckpt.finish();
   return 0;
 }
@@ -0,0 +1,509 @@
+// system includes
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <array>
+#include <sstream>
+
+// ROOT includes
+#include "TH1D.h"
+#include "TH2F.h"
+#include "TH1F.h"
+#include "TTree.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TStopwatch.h"
+#include "TLorentzVector.h"
+#include "ROOT/RDataFrame.hxx"
+
+// user includes
+#include "include/sample_table.h"
+#include "include/lazy_histos.h"
+#include "include/weight_table.h"
+#include "include/weight_variations.h"
+#include "include/bootstrap.h"
+#include "include/fast_hist.h"
+#include "include/zpt_table.h"
+#include "include/nnlops.h"
+#include "include/shared_hist.h"
+#include "include/util.h"
+#include "include/tauSF.h"
+#include "include/LumiReweightingStandAlone.h"
+#include "include/CLParser.h"
+#include "include/stitching.h"
+#include "include/output_writer.h"
+
+//////////////////////////////////////////////////////////////
+// Purpose: The tautau analysis of tt_analyzer.cc written   //
+// as an RDataFrame graph. The nominal and every requested  //
+// systematic are booked as actions on one graph, so the    //
+// input is read once by a single multithreaded event loop. //
+// Each variation is written to the same output file, with  //
+// the same directories and names, as the matching job of   //
+// tt_analyzer.cc.                                          //
+//   --systs a,b,...  : variations to run ("" is nominal),  //
+//                      "all" for the automate_analysis.py  //
+//                      list. Default is nominal only       //
+//   -j N             : number of threads (0 = all cores)   //
+//   --hist-mode M    : how threads share the 2D templates, //
+//                      atomic, local or auto (default),    //
+//                      see shared_hist.h                   //
+//////////////////////////////////////////////////////////////
+
+// branches read for one variation. Same substitutions as
+// event_info, jet_factory and met_factory, so the outputs
+// can be compared to tt_analyzer.cc one to one
+struct variation {
+  std::string syst, met, metphi, mjj, njets, m_sv, pt_sv;
+};
+
+variation make_variation(std::string syst) {
+  variation var {syst, "met", "metphi", "mjj", "njets", "m_sv", "pt_sv"};
+  if (syst.find("met") != std::string::npos) {
+    var.met = syst;
+  } else if (syst.find("metphi") != std::string::npos) {
+    var.metphi = syst;
+  }
+  if (syst.find("mjj") != std::string::npos) {
+    var.mjj = syst;
+  } else if (syst.find("njets") != std::string::npos) {
+    var.njets = syst;
+  }
+  if (syst.find("m_sv") != std::string::npos) {
+    var.m_sv = syst;
+  } else if (syst.find("pt_sv") != std::string::npos) {
+    var.pt_sv = syst;
+  }
+  return var;
+}
+
+// RDataFrame action filling the 2D templates of one variation
+// through shared_hist, by category and sign: h0_OS, h0_SS, h1_OS, ...
+// The result is the number of templates, set when the loop is done
+class template_fill : public ROOT::Detail::RDF::RActionImpl<template_fill> {
+public:
+  using Result_t = int;
+
+private:
+  std::vector<shared_hist*> hists;      // 2 * category + (OS ? 0 : 1)
+  std::shared_ptr<int> ntemplates;
+
+public:
+  template_fill(std::vector<shared_hist*> h) : hists(h), ntemplates(std::make_shared<int>(0)) {}
+  template_fill(template_fill&&) = default;
+  template_fill(const template_fill&) = delete;
+
+  std::shared_ptr<int> GetResultPtr() const { return ntemplates; }
+  void Initialize() {}
+  void InitTask(TTreeReader*, unsigned int) {}
+  void Exec(unsigned int slot, int cat, bool os, double x, double y, double evtwt) {
+    if (cat >= 0 && cat < 3) {
+      hists[2 * cat + (os ? 0 : 1)]->fill(slot, x, y, evtwt);
+    }
+  }
+  void Finalize() {
+    for (auto hist : hists) {
+      hist->flush();
+    }
+    *ntemplates = hists.size();
+  }
+  std::string GetActionName() { return "template_fill"; }
+};
+
+int main(int argc, char* argv[]) {
+
+  ////////////////////////////////////////////////
+  // Initial setup:                             //
+  // Get file names, normalization, paths, etc. //
+  ////////////////////////////////////////////////
+
+  CLParser parser(argc, argv);
+  std::string sample = parser.Option("-s");
+  std::string name = parser.Option("-n");
+  std::string path = parser.Option("-p");
+  std::string postfix = parser.Option("-P");
+  std::string systs_opt = parser.Option("--systs");
+  std::string threads = parser.Option("-j");
+  shared_hist::fill_mode hist_mode;
+  if (!shared_hist::readMode(parser.Option("--hist-mode"), hist_mode)) {
+    return 1;
+  }
+  std::string fname = path + sample + postfix;
+
+  // no event index here (event_index.h), so refuse its options rather than ignore them
+  for (auto option : {"--lumi-mask", "--overlap-with", "--event"}) {
+    if (!parser.Option(option).empty()) {
+      std::cerr << option << " is not supported by the RDataFrame backend, use tt_analyzer" << std::endl;
+      return 1;
+    }
+  }
+  if (parser.Flag("--dedup")) {
+    std::cerr << "--dedup is not supported by the RDataFrame backend, use tt_analyzer" << std::endl;
+    return 1;
+  }
+
+  // data/MC, cross sections and stitching come from inputs/samples.txt (sample_table.h)
+  if (!sample_table::get().check(sample, name)) {
+    return 1;
+  }
+  bool isData = sample_table::get().isData(sample);
+
+
+  std::vector<std::string> systs = {""};
+  if (systs_opt == "all") {
+    systs = {"", "met_UESUp", "met_UESDown", "met_JESUp", "met_JESDown", "metphi_UESUp", "metphi_UESDown",
+             "metphi_JESUp", "metphi_JESDown", "mjj_JESUp", "mjj_JESDown"};
+  } else if (!systs_opt.empty()) {
+    systs.clear();
+    std::stringstream ss(systs_opt);
+    std::string syst;
+    while (std::getline(ss, syst, ',')) {
+      systs.push_back(syst);
+    }
+  }
+
+  ROOT::EnableImplicitMT(threads.empty() ? 0 : std::stoi(threads));
+
+  // get number of generated events, the sample table takes precedence
+  std::cout << "Opening file... " << sample << std::endl;
+  auto fin = TFile::Open(fname.c_str());
+  if (!fin || fin->IsZombie() || !fin->Get("tt_tree")) {
+    std::cerr << "Unable to read tt_tree from " << fname << std::endl;
+    return 1;
+  }
+  auto counts = (TH1D*)fin->Get("nevents");
+  auto info = sample_table::get().find(sample);
+  double gen_number = info && info->nevents > 0. ? info->nevents : counts ? counts->GetBinContent(2) : 0.;
+  if (!isData && gen_number <= 0.) {
+    std::cerr << "No number of generated events for " << sample << " in " << fname << " or the sample table" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Loading Ntuple..." << std::endl;
+  ROOT::RDataFrame df("tt_tree", fname);
+
+  // one output file and Helper per variation, named like the tt_analyzer.cc jobs
+  auto suffix = "_output.root";
+  auto prefix = "output/";
+  std::vector<variation> vars;
+  std::vector<TFile*> fouts;
+  std::vector<output_writer*> writers;
+  std::vector<Helper*> helpers;
+  for (auto& syst : systs) {
+    auto var = make_variation(syst);
+    if (!df.HasColumn(var.met) || !df.HasColumn(var.metphi) || !df.HasColumn(var.mjj) ||
+        !df.HasColumn(var.njets) || !df.HasColumn(var.m_sv) || !df.HasColumn(var.pt_sv)) {
+      std::cerr << "No branches for systematic " << syst << " in " << fname << ", skipping it" << std::endl;
+      continue;
+    }
+    std::string systname = syst.empty() ? "" : "_" + syst;
+    std::string filename;
+    if (name == sample) {
+      filename = prefix + name + systname + suffix;
+    } else {
+      filename = prefix + sample + std::string("_") + name + systname + suffix;
+    }
+    auto writer = new output_writer(parser, filename);
+    if (!writer->isValid()) {
+      return 1;
+    }
+    auto fout = writer->open();
+    fout->mkdir("grabbag");
+    fout->cd("grabbag");
+    vars.push_back(var);
+    fouts.push_back(fout);
+    writers.push_back(writer);
+    helpers.push_back(new Helper(fout, name, syst));
+  }
+  if (helpers.empty()) {
+    std::cerr << "None of the requested systematics are in " << fname << std::endl;
+    return 1;
+  }
+
+  // get normalization (lumi & xs are in util.h), W and DY
+  // samples use the jet-multiplicity weights instead
+  std::array<double, 5> weights;
+  stitching stitch({sample}, path, postfix, *helpers.at(0));
+  if (isData) {
+    weights.fill(1.0);
+  } else if (stitch.getTable(sample)) {
+    weights = *stitch.getTable(sample);
+  } else {
+    weights.fill(helpers.at(0)->getLuminosity() * helpers.at(0)->getCrossSection(sample) / gen_number);
+  }
+
+  ///////////////////////////////////////////////
+  // Scale Factors:                            //
+  // Read weights, hists, graphs, etc. for SFs //
+  ///////////////////////////////////////////////
+
+  // read inputs for lumi reweighting
+  auto lumi_weights = new reweight::LumiReWeighting("inputs/MC_Moriond17_PU25ns_V1.root", "inputs/Data_Pileup_2016_271036-284044_80bins.root", "pileup", "pileup");
+
+  // Z-pT reweighting
+  zpt_table::range_policy zpt_range;
+  if (!zpt_table::readPolicy(parser.Option("--zpt-range"), zpt_range)) {
+    return 1;
+  }
+  zpt_table zpt_weights("inputs/zpt_weights_2016_BtoH.root", "zptmass_histo", zpt_range);
+  if (!zpt_weights.isValid()) {
+    return 1;
+  }
+
+  // NNLOPS reweighting of ggH
+  nnlops nnlops_weights("inputs/NNLOPS_reweight.root", 0.5, parser.Flag("--nnlops-check"));
+  if (!nnlops_weights.isValid()) {
+    return 1;
+  }
+  if (parser.Flag("--nnlops-check")) {
+    nnlops_weights.check(10000);
+  }
+
+  // tauSF::compute_SF looks parameters up with map::operator[],
+  // so every thread gets its own copy
+  std::vector<tauSF> slot_sfs(df.GetNSlots());
+  tauSF zmm_sfs;
+
+  bool isZ = name == "ZTT" || name == "ZLL" || name == "ZL" || name == "ZJ";
+  bool doZpt = isZ || name == "EWKZLL" || name == "EWKZNuNu";
+  bool doTop = name == "TTT" || name == "TT" || name == "TTJ";
+  bool doNNLOPS = name.find("ggH") == 0;
+
+  //////////////////////////////////////////////////////////
+  // Event Selection:                                     //
+  //   - Trigger: DoubleTauCmbIso35 && DoubleTau35        //
+  //       - pass, match, filter                          //
+  //   - Taus: Loose Iso, against mu & el, el & mu vetos  //
+  //   - Ditau: dR(t1, t2) < 0.5                          //
+  //////////////////////////////////////////////////////////
+
+  // taus sorted by pT, like ditau_factory
+  ROOT::RDF::RNode taus = df;
+  auto lead    = [](Float_t pt_1, Float_t pt_2, Float_t x_1, Float_t x_2) { return pt_1 > pt_2 ? x_1 : x_2; };
+  auto sublead = [](Float_t pt_1, Float_t pt_2, Float_t x_1, Float_t x_2) { return pt_1 > pt_2 ? x_2 : x_1; };
+  std::vector<std::pair<std::string, std::pair<std::string, std::string>>> tau_vars = {
+    {"pt", {"pt_1", "pt_2"}},
+    {"eta", {"eta_1", "eta_2"}},
+    {"phi", {"phi_1", "phi_2"}},
+    {"m", {"m_1", "m_2"}},
+    {"q", {"q_1", "q_2"}},
+    {"gen_match", {"gen_match_1", "gen_match_2"}},
+    {"decayMode", {"t1_decayMode", "t2_decayMode"}},
+    {"tightIso", {"byTightIsolationMVArun2v1DBoldDMwLT_1", "byTightIsolationMVArun2v1DBoldDMwLT_2"}}
+  };
+  for (auto& v : tau_vars) {
+    taus = taus.Define("tau1_" + v.first, lead, {"pt_1", "pt_2", v.second.first, v.second.second})
+               .Define("tau2_" + v.first, sublead, {"pt_1", "pt_2", v.second.first, v.second.second});
+  }
+  auto p4 = [](Float_t pt, Float_t eta, Float_t phi, Float_t m) {
+    TLorentzVector vec;
+    vec.SetPtEtaPhiM(pt, eta, phi, m);
+    return vec;
+  };
+  taus = taus.Define("tau1_p4", p4, {"tau1_pt", "tau1_eta", "tau1_phi", "tau1_m"})
+             .Define("tau2_p4", p4, {"tau2_pt", "tau2_eta", "tau2_phi", "tau2_m"});
+
+  // trigger selection
+  auto trigger = taus.Filter([](Float_t pass_cmb, Float_t match_cmb_1, Float_t match_cmb_2, Float_t filter_cmb_1, Float_t filter_cmb_2,
+                                Float_t pass, Float_t match_1, Float_t match_2, Float_t filter_1, Float_t filter_2) {
+      return (pass_cmb && (match_cmb_1 || match_cmb_2) && (filter_cmb_1 || filter_cmb_2))
+          || (pass && (match_1 || match_2) && (filter_1 || filter_2));
+    }, {"passDoubleTauCmbIso35", "matchDoubleTauCmbIso35_1", "matchDoubleTauCmbIso35_2", "filterDoubleTauCmbIso35_1", "filterDoubleTauCmbIso35_2",
+        "passDoubleTau35", "matchDoubleTau35_1", "matchDoubleTau35_2", "filterDoubleTau35_1", "filterDoubleTau35_2"});
+
+  // tau against electron/muon selection (ditau_factory reads againstElectronVLooseMVA6_1 for both taus)
+  auto against = trigger.Filter([](Float_t against_el, Float_t against_mu_1, Float_t against_mu_2) {
+      return against_el || against_mu_1 || against_mu_2;
+    }, {"againstElectronVLooseMVA6_1", "againstMuonLoose3_1", "againstMuonLoose3_2"});
+
+  // |eta| < 2.1
+  auto eta = against.Filter([](Float_t eta1, Float_t eta2) { return fabs(eta1) < 2.1 && fabs(eta2) < 2.1; }, {"tau1_eta", "tau2_eta"});
+
+  // dR(t1, t2) selection
+  auto dR = eta.Filter([](TLorentzVector t1, TLorentzVector t2) { return t1.DeltaR(t2) != 0; }, {"tau1_p4", "tau2_p4"});
+
+  // finally, apply vetos
+  auto vetos = dR.Filter([](Float_t mu_veto, Float_t el_veto) { return !mu_veto && !el_veto; }, {"extramuon_veto", "extraelec_veto"});
+
+  // Separate Drell-Yan
+  auto matched = vetos.Filter([name](Float_t match1, Float_t match2) {
+      if ((name == "ZTT" || name == "TTT" || name == "VVT") && !(match1 == 5 && match2 == 5)) {
+        return false;
+      } else if ((name == "ZJ" || name == "TTJ" || name == "VVJ") && !(match1 == 6 || match2 == 6)) {
+        return false;
+      } else if (name == "ZL" && (match1 < 6 && match2 < 6) && !(match1 == 5 && match2 == 5)) {
+        return false;
+      }
+      return true;
+    }, {"tau1_gen_match", "tau2_gen_match"});
+  // end event selection
+
+  // find the event weight (not lumi*xs if looking at W or Drell-Yan)
+  auto weighted = matched.Define("stitch", [weights](Float_t n_gen_jets) {
+      return weights[stitching::bin(n_gen_jets)];
+    }, {"numGenJets"});
+
+  // apply all scale factors/corrections/etc.
+  if (isData) {
+    weighted = weighted.Alias("evtwt", "stitch");
+  } else {
+    weighted = weighted.DefineSlot("evtwt", [&slot_sfs, &zpt_weights, &nnlops_weights, lumi_weights, doZpt, doTop, doNNLOPS]
+        (unsigned int slot, double evtwt, Float_t pt1, Float_t dm1, Float_t dm2, Float_t match1, Float_t match2,
+         Float_t eta1, Float_t eta2, Float_t npu, Float_t genweight, Float_t gen_m, Float_t gen_pt, Float_t pt_top1, Float_t pt_top2,
+         Float_t n_gen_jets) {
+      auto& tauSFs = slot_sfs[slot];
+
+      // apply trigger and id SF's (both use the leading tau pT, as in tt_analyzer.cc)
+      double sf_trig1 = tauSFs.compute_SF(pt1, std::to_string(int(dm1)));
+      double sf_trig2 = tauSFs.compute_SF(pt1, std::to_string(int(dm2)));
+      evtwt *= (sf_trig1 * sf_trig2 * lumi_weights->weight(npu) * genweight);
+
+      // tau ID efficiency SF
+      if (match1 == 5) {
+        evtwt *= 0.95;
+      }
+      if (match2 == 5) {
+        evtwt *= 0.95;
+      }
+
+      // anti-lepton discriminator SFs
+      evtwt *= tauSFs.tauID_SF(match1, eta1);
+      evtwt *= tauSFs.tauID_SF(match2, eta2);
+
+      // NNLOPS reweighting of the POWHEG ggH samples
+      if (doNNLOPS) {
+        evtwt *= nnlops_weights.weight(int(n_gen_jets), gen_pt);
+      }
+
+      // Z-pT Reweighting
+      if (doZpt) {
+        evtwt *= zpt_weights.weight(gen_m, gen_pt);
+      }
+
+      // top-pT Reweighting
+      if (doTop) {
+        pt_top1 = std::min(float(400.), pt_top1);
+        pt_top2 = std::min(float(400.), pt_top2);
+        evtwt *= sqrt(exp(0.0615-0.0005*pt_top1)*exp(0.0615-0.0005*pt_top2));
+      }
+      return evtwt;
+    }, {"stitch", "tau1_pt", "tau1_decayMode", "tau2_decayMode", "tau1_gen_match", "tau2_gen_match",
+        "tau1_eta", "tau2_eta", "npu", "genweight", "genM", "genpT", "pt_top1", "pt_top2", "numGenJets"});
+  }
+
+  // signal region with the tau pT thresholds, common to all variations
+  auto signal = weighted.Filter([](Float_t iso1, Float_t iso2, Float_t pt1, Float_t pt2) {
+      return iso1 && iso2 && pt1 > 50 && pt2 > 40;
+    }, {"tau1_tightIso", "tau2_tightIso", "tau1_pt", "tau2_pt"})
+    .Define("OS", [](Float_t q1, Float_t q2) { return int(q1 + q2) == 0; }, {"tau1_q", "tau2_q"})
+    .Define("normMELA", [](Float_t vbf, Float_t bkg) { return double(vbf / (vbf + 45 * bkg)); }, {"ME_sm_VBF", "ME_bkg"});
+
+  // cutflow, filled from the counts at each step after the loop
+  auto n_all = df.Count();
+  auto n_trigger = trigger.Count();
+  auto n_against = against.Count();
+  auto n_eta = eta.Count();
+  auto n_dR = dR.Count();
+  auto n_vetos = vetos.Count();
+  auto n_matched = matched.Count();
+
+  ///////////////////////////////////////////////////
+  // Variations:                                   //
+  // categories and Zmm SF depend on the branches  //
+  // of each variation, then book the 2D templates //
+  ///////////////////////////////////////////////////
+  std::vector<ROOT::RDF::RResultPtr<int>> results;
+  std::vector<shared_hist*> templates;
+  for (unsigned i = 0; i < vars.size(); i++) {
+    auto& var = vars.at(i);
+    auto tag = "_" + std::to_string(i);
+
+    // create categories
+    auto categorized = signal.Define("cat" + tag, [](TLorentzVector t1, TLorentzVector t2, Float_t met, Float_t metphi, Int_t njets, Float_t jeta_1, Float_t jeta_2) {
+        TLorentzVector met_p4;
+        met_p4.SetPtEtaPhiM(met, 0, metphi, 0);
+        auto higgs_pt = (t1 + t2 + met_p4).Pt();
+        bool boosted = (njets == 1 || (njets > 1 && !(higgs_pt < 100 && fabs(jeta_1 - jeta_2) > 2.5)));
+        bool vbfCat = (njets > 1 && higgs_pt > 100 && fabs(jeta_1 - jeta_2) > 2.5);
+        if (njets == 0) {
+          return 0;
+        } else if (boosted) {
+          return 1;
+        } else if (vbfCat) {
+          return 2;
+        }
+        return -1;
+      }, {"tau1_p4", "tau2_p4", var.met, var.metphi, var.njets, "jeta_1", "jeta_2"})
+      .Define("evtwt" + tag, [&zmm_sfs, doZpt, syst = var.syst](double evtwt, int cat, Float_t pt_sv, Float_t mjj) {
+        if (doZpt) {
+          if (cat == 1) {
+            evtwt *= zmm_sfs.boosted_ZmmSF(pt_sv, syst);
+          } else if (cat == 2) {
+            evtwt *= zmm_sfs.VBF_ZmmSF(mjj, syst);
+          }
+        }
+        return evtwt;
+      }, {"evtwt", "cat" + tag, var.pt_sv, var.mjj})
+      .Define("x" + tag, [](int cat, Float_t m_sv, Float_t pt_sv, double normMELA) {
+        return cat == 0 ? double(m_sv) : cat == 1 ? double(pt_sv) : normMELA;
+      }, {"cat" + tag, var.m_sv, var.pt_sv, "normMELA"})
+      .Define("y" + tag, [](int cat, Float_t m_sv) { return cat == 1 ? double(m_sv) : 1.; }, {"cat" + tag, var.m_sv});
+
+    // event categorization
+    auto histos_2d = helpers.at(i)->getHistos2D();
+    std::vector<shared_hist*> hists;
+    for (int cat = 0; cat < 3; cat++) {
+      for (auto os : {true, false}) {
+        auto key = "h" + std::to_string(cat) + (os ? "_OS" : "_SS");
+        hists.push_back(new shared_hist(histos_2d->at(key), df.GetNSlots(), hist_mode));
+      }
+    }
+    results.push_back(categorized.Book<int, bool, double, double, double>(template_fill(hists), {"cat" + tag, "OS", "x" + tag, "y" + tag, "evtwt" + tag}));
+    templates.insert(templates.end(), hists.begin(), hists.end());
+  }
+
+  // everything is booked, run the event loop once
+  TStopwatch timer;
+  auto nevts = *n_all;
+  timer.Stop();
+  std::cout << "Processed " << nevts << " events for " << vars.size() << " variations in " << timer.RealTime()
+            << " s (" << nevts / timer.RealTime() << " events/s)" << std::endl;
+
+  size_t template_bytes(0);
+  int nlocal(0);
+  for (auto hist : templates) {
+    template_bytes += hist->getBytes();
+    nlocal += hist->getNLocal();
+  }
+  std::cout << "Filled " << templates.size() << " templates with " << df.GetNSlots() << " slots, " << nlocal << " per-slot copies, "
+            << template_bytes / 1024. << " kB" << std::endl;
+
+  for (unsigned i = 0; i < vars.size(); i++) {
+    auto histos = helpers.at(i)->getHistos1D();
+    histos->at("cutflow")->Fill(1., *n_all);
+    histos->at("cutflow")->Fill(2., *n_trigger);
+    histos->at("cutflow")->Fill(3., *n_against);
+    histos->at("cutflow")->Fill(4., *n_eta);
+    histos->at("cutflow")->Fill(5., *n_dR);
+    histos->at("cutflow")->Fill(6., *n_matched);
+    // tt_analyzer.cc fills bin 7 after the vetos and again at the end of the loop
+    histos->at("cutflow")->Fill(7., *n_vetos + *n_matched);
+    histos->at("cutflow")->Fill(11., *n_matched);
+
+    helpers.at(i)->flush();
+    fouts.at(i)->cd("grabbag");
+    histos->at("n70")->Fill(1, 0.);
+    histos->at("n70")->Write();
+
+    // the next variation is finished while this one is written
+    writers.at(i)->start();
+  }
+  for (auto writer : writers) {
+    writer->close();
+  }
+  fin->Close();
+  return 0;
+}